@@ -0,0 +1,319 @@
+/**
+ * Benchmark client measuring throughput, latency and the round-trip overhead of talking to the solver (i.e. the time
+ * per request that is not spent solving). It sends all cubes of `bench.cubes` and checks every returned solution.
+ *
+ * Usage: ./twophase-client [-s] [-p MICROS] [-m MILLIS] COMMAND [ARGS ...], e.g. ./twophase-client ./twophase -m 1
+ *        ./twophase-client [-p MICROS] [-m MILLIS] [-c N_CONNECTIONS] -u SOCKET
+ * The first form starts the given solver command and drives it in binary mode (`-b` is appended to the command), with
+ * `-s` via the text protocol. The second one talks to a running daemon (see `-u` of the solver), spreading the cubes
+ * over `-c` concurrent connections. `-m` sets the time-limit of every request (default: the solver's). `-p` pauses
+ * before every request like a robot between solves would; the solver can then prepare its threads in time instead of
+ * while the next request is already waiting.
+ */
+
+#include <algorithm>
+#include <cstring>
+#include <chrono>
+#include <fstream>
+#include <getopt.h>
+#include <iostream>
+#include <map>
+#include <numeric>
+#include <sstream>
+#include <string>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+
+#include "cubie.h"
+#include "face.h"
+#include "move.h"
+#include "proto.h"
+
+const std::string BENCH_FILE = "bench.cubes";
+
+bool check(const cubie::cube& c, const std::vector<int>& sol) {
+  cubie::packed p1;
+  cubie::packed p2;
+
+  cubie::pack(c, p1);
+  for (int m : sol) {
+    cubie::mul(p1, move::pcubes[m], p2);
+    std::swap(p1, p2);
+  }
+
+  return p1 == cubie::PACKED_SOLVED;
+}
+
+// Start `argv` with stdin and stdout connected to `in` and `out` of the client
+void spawn(char *argv[], int& in, int& out) {
+  int to_child[2];
+  int from_child[2];
+  if (pipe(to_child) || pipe(from_child)) {
+    std::cerr << "Error: Cannot create pipes." << std::endl;
+    exit(1);
+  }
+  if (fork() == 0) {
+    dup2(to_child[0], 0);
+    dup2(from_child[1], 1);
+    close(to_child[1]);
+    close(from_child[0]);
+    execvp(argv[0], argv);
+    std::cerr << "Error: Cannot start " << argv[0] << "." << std::endl;
+    exit(1);
+  }
+  close(to_child[0]);
+  close(from_child[1]);
+  out = to_child[1];
+  in = from_child[0];
+}
+
+// Minimal buffered line reading from the solver's stdout in text mode
+struct lines {
+  int fd;
+  std::string buf;
+
+  bool next(std::string& line) {
+    size_t pos;
+    while ((pos = buf.find('\n')) == std::string::npos) {
+      char tmp[4096];
+      int n = read(fd, tmp, sizeof(tmp));
+      if (n <= 0)
+        return false;
+      buf.append(tmp, n);
+    }
+    line = buf.substr(0, pos);
+    buf.erase(0, pos + 1);
+    return true;
+  }
+};
+
+// Solve `c` via the binary protocol; returns false if the connection broke
+bool solve_binary(int in, int out, uint32_t id, int tlim, const cubie::cube& c, std::vector<int>& sol, double& time) {
+  proto::request req = {};
+  req.id = id;
+  req.tlim = tlim;
+  req.format = proto::FACELETS;
+  std::string s = face::from_cubie(c);
+  std::copy(s.begin(), s.end(), req.cube);
+  if (!proto::write_full(out, &req, sizeof(req)))
+    return false;
+
+  proto::response res;
+  if (!proto::read_full(in, &res, sizeof(res)) || res.id != id)
+    return false;
+  std::vector<uint8_t> buf(res.size);
+  if (!proto::read_full(in, buf.data(), res.size))
+    return false;
+  sol.clear();
+  if (res.status == proto::OK && res.n_sols > 0)
+    sol.assign(buf.begin() + 1, buf.begin() + 1 + buf[0]);
+  time = res.time / 1000.;
+  return true;
+}
+
+// Solve `c` via the text protocol (the solver has already printed its "Ready!")
+bool solve_text(lines& in, int out, const std::map<std::string, int>& moves, const cubie::cube& c, std::vector<int>& sol, double& time) {
+  std::string req = "solve " + face::from_cubie(c) + "\n";
+  if (!proto::write_full(out, req.data(), req.size()))
+    return false;
+
+  std::string line;
+  if (!in.next(line))
+    return false;
+  time = atof(line.c_str()); // "X.XXXms" unless there was an error
+  sol.clear();
+  bool first = true;
+  while (in.next(line)) {
+    if (line == "Ready!")
+      return true;
+    if (!first)
+      continue;
+    first = false;
+    // Move names may contain spaces (axial moves), hence match them greedily
+    std::string name;
+    std::istringstream ss(line);
+    std::string tok;
+    while (ss >> tok) {
+      name += name.empty() ? tok : " " + tok;
+      auto it = moves.find(name);
+      if (it != moves.end()) {
+        sol.push_back(it->second);
+        name.clear();
+      }
+    }
+  }
+  return false;
+}
+
+// Connect to the daemon listening on `path`; -1 on failure
+int connect_to(const std::string& path) {
+  sockaddr_un addr = {};
+  addr.sun_family = AF_UNIX;
+  strncpy(addr.sun_path, path.c_str(), sizeof(addr.sun_path) - 1);
+  int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+  if (fd < 0 || connect(fd, (sockaddr *) &addr, sizeof(addr))) {
+    close(fd);
+    return -1;
+  }
+  return fd;
+}
+
+// Results of a single connection
+struct stats {
+  std::vector<double> rtts;
+  std::vector<double> overheads;
+  int failed = 0;
+  bool lost = false;
+};
+
+int main(int argc, char *argv[]) {
+  bool text = false;
+  int pause = 0;
+  int n_conns = 1;
+  int tlim = 0;
+  std::string socket;
+
+  int opt;
+  while ((opt = getopt(argc, argv, "+c:m:p:su:")) != -1) { // `+` stops at the solver command
+    switch (opt) {
+      case 'c':
+        n_conns = std::max(atoi(optarg), 1);
+        break;
+      case 'm':
+        tlim = atoi(optarg);
+        break;
+      case 'p':
+        pause = atoi(optarg);
+        break;
+      case 's':
+        text = true;
+        break;
+      case 'u':
+        socket = optarg;
+        break;
+      default:
+        optind = argc;
+        socket.clear();
+    }
+  }
+  if ((socket.empty() && optind >= argc) || (!socket.empty() && text) || (socket.empty() && n_conns > 1)) {
+    std::cerr << "Usage: ./twophase-client [-s] [-p MICROS] [-m MILLIS] COMMAND [ARGS ...]" << std::endl;
+    std::cerr << "       ./twophase-client [-p MICROS] [-m MILLIS] [-c N_CONNECTIONS] -u SOCKET" << std::endl;
+    return 1;
+  }
+  std::vector<char *> cmd(argv + optind, argv + argc);
+  if (!text)
+    cmd.push_back((char *) "-b");
+  cmd.push_back(nullptr);
+
+  face::init();
+  move::init();
+  std::map<std::string, int> moves;
+  for (int m = 0; m < move::COUNT; m++)
+    moves[move::names[m]] = m;
+
+  std::ifstream fstream(BENCH_FILE);
+  std::string s;
+  std::vector<cubie::cube> cubes;
+  while (std::getline(fstream, s)) {
+    cubie::cube c;
+    if (face::to_cubie(s, c) == 0)
+      cubes.push_back(c);
+  }
+  if (cubes.size() == 0) {
+    std::cerr << "Error: No cubes in " << BENCH_FILE << "." << std::endl;
+    return 1;
+  }
+  n_conns = std::min(n_conns, (int) cubes.size());
+
+  std::vector<int> ins(n_conns);
+  std::vector<int> outs(n_conns);
+  if (socket.empty())
+    spawn(cmd.data(), ins[0], outs[0]);
+  else {
+    for (int k = 0; k < n_conns; k++) {
+      if ((ins[k] = outs[k] = connect_to(socket)) < 0) {
+        std::cerr << "Error: Cannot connect to " << socket << "." << std::endl;
+        return 1;
+      }
+    }
+  }
+
+  // Connection `k` solves every `n_conns`-th cube; its first request only warms up and is not counted
+  std::vector<stats> results(n_conns);
+  auto run = [&](int k) {
+    stats& res = results[k];
+    lines text_in = {ins[k], ""};
+    std::string line;
+    if (text) {
+      while (text_in.next(line) && line != "Ready!");
+    }
+
+    std::vector<int> sol;
+    for (int i = k - n_conns; i < (int) cubes.size(); i += n_conns) {
+      const cubie::cube& c = cubes[std::max(i, k)];
+      double time;
+      if (pause > 0)
+        usleep(pause);
+      auto tick = std::chrono::high_resolution_clock::now();
+      bool ok = text ?
+        solve_text(text_in, outs[k], moves, c, sol, time) : solve_binary(ins[k], outs[k], i + n_conns, tlim, c, sol, time);
+      double rtt = std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::high_resolution_clock::now() - tick
+      ).count() / 1e6;
+      if (!ok) {
+        res.lost = true;
+        return;
+      }
+      if (i < 0)
+        continue;
+      if (sol.empty() || !check(c, sol))
+        res.failed++;
+      res.rtts.push_back(rtt);
+      res.overheads.push_back(std::max(rtt - time, 0.));
+    }
+  };
+
+  auto tick = std::chrono::high_resolution_clock::now();
+  std::vector<std::thread> threads;
+  for (int k = 0; k < n_conns; k++)
+    threads.push_back(std::thread(run, k));
+  for (std::thread& t : threads)
+    t.join();
+  double total = std::chrono::duration_cast<std::chrono::microseconds>(
+    std::chrono::high_resolution_clock::now() - tick
+  ).count() / 1e6;
+  for (int k = 0; k < n_conns; k++)
+    close(outs[k]); // makes a spawned solver exit
+
+  stats all;
+  for (stats& res : results) {
+    if (res.lost) {
+      std::cerr << "Error: Connection to solver lost." << std::endl;
+      return 1;
+    }
+    all.rtts.insert(all.rtts.end(), res.rtts.begin(), res.rtts.end());
+    all.overheads.insert(all.overheads.end(), res.overheads.begin(), res.overheads.end());
+    all.failed += res.failed;
+  }
+  std::sort(all.rtts.begin(), all.rtts.end());
+  std::sort(all.overheads.begin(), all.overheads.end());
+
+  std::cout << "Requests: " << all.rtts.size() << " (" << (text ? "text" : "binary") << ", "
+    << n_conns << " connection(s))" << std::endl;
+  std::cout << "Failed: " << all.failed << std::endl;
+  std::cout << "Throughput: " << all.rtts.size() / total << " solves/s" << std::endl;
+  std::cout << "Avg. Round-Trip: " << std::accumulate(all.rtts.begin(), all.rtts.end(), 0.) / all.rtts.size()
+    << " ms (median " << all.rtts[all.rtts.size() / 2] << " ms, 99% " << all.rtts[all.rtts.size() * 99 / 100] << " ms)"
+  << std::endl;
+  std::cout << "Avg. Overhead: "
+    << 1000 * std::accumulate(all.overheads.begin(), all.overheads.end(), 0.) / all.overheads.size() << " us (median "
+    << 1000 * all.overheads[all.overheads.size() / 2] << " us, 99% "
+    << 1000 * all.overheads[all.overheads.size() * 99 / 100] << " us)"
+  << std::endl;
+
+  return 0;
+}
@@ -5,23 +5,32 @@
 #include <cstring>
 
 #include "cubie.h"
+#include "parallel.h"
 
 namespace coord {
 
   const int N_C12K4 = 495; // binom(12, 4)
   const int N_PERM4 = 24; // 4!
 
-  uint16_t move_flip[N_FLIP][move::COUNT];
-  uint16_t move_twist[N_TWIST][move::COUNT];
-  uint16_t move_edges4[N_SLICE][move::COUNT];
-  uint16_t move_corners[N_CORNERS][move::COUNT];
-  uint16_t move_udedges2[N_UDEDGES2][move::COUNT];
+  uint16_t move_edges4[N_SLICE][move::COUNT_P1];
+  uint16_t move_corners[N_CORNERS][move::COUNT_P1];
 
-  /* Used for en-/decoding pos-perm coords */
-  uint8_t enc_perm[1 << (4 * 2)]; // encode 4-elem perm as 8 bits
-  uint8_t dec_perm[N_PERM4];
-  uint16_t enc_comb[1 << 12]; // encode 4-elem comb as 12-bit mask with exactly 4 bits on
-  uint16_t dec_comb[N_C12K4];
+  uint16_t move_slice2[N_SLICE2][move::COUNT_P2];
+  uint16_t move_corners2[N_CORNERS][move::COUNT_P2];
+  uint16_t move_udedges2[N_UDEDGES2][move::COUNT_P2];
+
+  #ifdef GENTABLES
+    uint16_t move_flip[N_FLIP][move::COUNT_P1];
+    uint16_t move_twist[N_TWIST][move::COUNT_P1];
+
+    /* Used for en-/decoding pos-perm coords */
+    uint8_t enc_perm[1 << (4 * 2)]; // encode 4-elem perm as 8 bits
+    uint8_t dec_perm[N_PERM4];
+    uint16_t enc_comb[1 << 12]; // encode 4-elem comb as 12-bit mask with exactly 4 bits on
+    uint16_t dec_comb[N_C12K4];
+  #else
+    #include "gen/coord.inc"
+  #endif
 
   int binarize_perm(int perm[]) {
     int bin = 0;
@@ -30,29 +39,33 @@ namespace coord {
     return bin;
   }
 
-  void init_encdec() {
-    int perm[] = {0, 1, 2, 3};
-    for (int i = 0; i < N_PERM4; i++) {
-      int bin = binarize_perm(perm);
-      enc_perm[bin] = i;
-      dec_perm[i] = bin;
-      std::next_permutation(perm, perm + 4);
-    }
+  #ifdef GENTABLES
+    void init_encdec() {
+      int perm[] = {0, 1, 2, 3};
+      for (int i = 0; i < N_PERM4; i++) {
+        int bin = binarize_perm(perm);
+        enc_perm[bin] = i;
+        dec_perm[i] = bin;
+        std::next_permutation(perm, perm + 4);
+      }
 
-    int i = 0;
-    for (int comb = 0; comb < (1 << cubie::edge::COUNT); comb++) {
-      if (std::bitset<cubie::edge::COUNT>(comb).count() == 4) {
-        enc_comb[comb] = i;
-        dec_comb[i] = comb;
-        i++;
+      int i = 0;
+      for (int comb = 0; comb < (1 << cubie::edge::COUNT); comb++) {
+        if (std::bitset<cubie::edge::COUNT>(comb).count() == 4) {
+          enc_comb[comb] = i;
+          dec_comb[i] = comb;
+          i++;
+        }
       }
     }
-  }
+  #endif
 
-  int get_ori(const int oris[], int len, int n_oris) {
+  /* Getters work on both the plain and the packed cube (perm in the lower 4 bits, ori starting at bit `shift`) */
+  template <typename T>
+  int get_ori(const T oris[], int len, int n_oris, int shift = 0) {
     int val = 0;
     for (int i = 0; i < len - 1; i++) // last ori can be reconstructed by parity
-      val = n_oris * val + oris[i];
+      val = n_oris * val + ((oris[i] >> shift) & 0x3);
     return val;
   }
 
@@ -68,16 +81,18 @@ namespace coord {
   }
 
   // `mask` indicates which 4 edges to compute the coordinate for
-  int get_combperm(const int cubies[], int len, int mask) {
+  template <typename T>
+  int get_combperm(const T cubies[], int len, int mask) {
     int min_cubie = ffs(mask) - 1;
 
     int comb = 0;
     int perm = 0;
 
     for (int i = len - 1; i >= 0; i--) {
-      if (mask & (1 << cubies[i])) {
+      int cubie = cubies[i] & 0xf;
+      if (mask & (1 << cubie)) {
         comb |= 1 << i;
-        perm = (perm << 2) | (cubies[i] - min_cubie);
+        perm = (perm << 2) | (cubie - min_cubie);
       }
     }
 
@@ -102,17 +117,19 @@ namespace coord {
 
   /* Faster than using `*_comperm()` twice */
 
-  int get_perm8(const int cubies[]) {
+  template <typename T>
+  int get_perm8(const T cubies[]) {
     int comb1 = 0;
     int perm1 = 0;
     int perm2 = 0;
 
     for (int i = 7; i >= 0; i--) {
-      if (cubies[i] < 4) {
+      int cubie = cubies[i] & 0xf;
+      if (cubie < 4) {
         comb1 |= 1 << i;
-        perm1 = (perm1 << 2) | cubies[i];
+        perm1 = (perm1 << 2) | cubie;
       } else
-        perm2 = (perm2 << 2) | (cubies[i] - 4);
+        perm2 = (perm2 << 2) | (cubie - 4);
     }
 
     comb1 = enc_comb[comb1];
@@ -187,15 +204,20 @@ namespace coord {
 
   /* Dedicated methods again more efficient than `*_posperm()` */
 
-  int get_slice1(const cubie::cube& c) {
+  template <typename T>
+  int get_slice1(const T eperm[]) {
     int slice1 = 0;
     for (int i = cubie::edge::COUNT - 1; i >= 0; i--) {
-      if (c.eperm[i] >= cubie::edge::FR)
+      if ((eperm[i] & 0xf) >= cubie::edge::FR)
         slice1 |= 1 << i;
     }
     return enc_comb[slice1];
   }
 
+  int get_slice1(const cubie::cube& c) {
+    return get_slice1(c.eperm);
+  }
+
   void set_slice1(cubie::cube& c, int slice1) {
     slice1 = dec_comb[slice1];
     int j = cubie::edge::FR;
@@ -204,6 +226,42 @@ namespace coord {
       c.eperm[i] = (slice1 & (1 << i)) ? j++ : cubie++;
   }
 
+  int get_flip(const cubie::packed& p) {
+    return get_ori(p.edges, cubie::edge::COUNT, 2, 4);
+  }
+
+  int get_twist(const cubie::packed& p) {
+    return get_ori(p.corners, cubie::corner::COUNT, 3, 4);
+  }
+
+  int get_slice(const cubie::packed& p) {
+    return get_combperm(p.edges, cubie::edge::COUNT, 0xf00);
+  }
+
+  int get_corners(const cubie::packed& p) {
+    return get_perm8(p.corners);
+  }
+
+  int get_slice1(const cubie::packed& p) {
+    return get_slice1(p.edges);
+  }
+
+  int get_slice2(const cubie::packed& p) {
+    return slice_to_slice2(get_slice(p));
+  }
+
+  int get_udedges2(const cubie::packed& p) {
+    return get_perm8(p.edges);
+  }
+
+  int get_slice2(const cubie::cube& c) {
+    return slice_to_slice2(get_slice(c));
+  }
+
+  void set_slice2(cubie::cube& c, int slice2) {
+    set_slice(c, slice2_to_slice(slice2));
+  }
+
   int get_udedges2(const cubie::cube& c) {
     return get_perm8(c.eperm);
   }
@@ -212,45 +270,47 @@ namespace coord {
     set_perm8(udedges2, c.eperm);
   }
 
-  // Computing only exactly the moves that are needed and storing them tightly would only make things more complicated
-  // during solving (in exchange for completely negligible setup/memory-gains)
+  // Entries of the moves in `moves` are stored tightly (in move order) in the rows of `move_coord`
   void init_move(
-    uint16_t move_coord[][move::COUNT],
+    uint16_t *move_coord,
     int n_coord,
-    int (*get_coord)(const cubie::cube&),
+    int (*get_coord)(const cubie::packed&),
     void (*set_coord)(cubie::cube&, int),
-    void (*mul)(const cubie::cube&, const cubie::cube&, cubie::cube&),
-    bool phase2 = false
+    void (*mul)(const cubie::packed&, const cubie::packed&, cubie::packed&),
+    move::mask moves
   ) {
-    cubie::cube c1 = cubie::SOLVED_CUBE; // coords only affect perm or ori -> one would be uninitialized
-    cubie::cube c2;
-
-    for (int coord = 0; coord < n_coord; coord++) {
-      set_coord(c1, coord);
-
-      if (phase2) { // UDEDGES2 is only defined for phase 2 moves
-        for (move::mask moves = move::p2mask; moves; moves &= moves - 1) {
-          int m = ffsll(moves) - 1;
-          mul(c1, move::cubes[m], c2);
-          move_coord[coord][m] = get_coord(c2);
-        }
-      } else {
-        for (int m = 0; m < move::COUNT; m++) {
-          mul(c1, move::cubes[m], c2);
-          move_coord[coord][m] = get_coord(c2);
+    int n_moves = std::bitset<64>(moves).count();
+
+    parallel::blocks(n_coord, 1024, [&](int start, int end) {
+      cubie::cube c1 = cubie::SOLVED_CUBE; // coords only affect perm or ori -> one would be uninitialized
+      cubie::packed p1;
+      cubie::packed p2;
+
+      uint16_t *row = move_coord + n_moves * start;
+      for (int coord = start; coord < end; coord++) {
+        set_coord(c1, coord);
+        cubie::pack(c1, p1);
+        for (move::mask mm = moves; mm; mm &= mm - 1) {
+          mul(p1, move::pcubes[ffsll(mm) - 1], p2);
+          *(row++) = get_coord(p2);
         }
       }
-    }
+    });
   }
 
   void init() {
-    init_encdec();
-
-    init_move(move_flip, N_FLIP, get_flip, set_flip, cubie::edge::mul);
-    init_move(move_twist, N_TWIST, get_twist, set_twist, cubie::corner::mul);
-    init_move(move_edges4, N_SLICE, get_slice, set_slice, cubie::edge::mul);
-    init_move(move_corners, N_CORNERS, get_corners, set_corners, cubie::corner::mul);
-    init_move(move_udedges2, N_UDEDGES2, get_udedges2, set_udedges2, cubie::edge::mul, true);
+    #ifdef GENTABLES
+      init_encdec();
+      init_move(move_flip[0], N_FLIP, get_flip, set_flip, cubie::edge::mul, move::p1mask);
+      init_move(move_twist[0], N_TWIST, get_twist, set_twist, cubie::corner::mul, move::p1mask);
+    #endif
+    init_move(move_edges4[0], N_SLICE, get_slice, set_slice, cubie::edge::mul, move::p1mask);
+    init_move(move_corners[0], N_CORNERS, get_corners, set_corners, cubie::corner::mul, move::p1mask);
+
+    // UDEDGES2 is only defined for phase 2 moves
+    init_move(move_slice2[0], N_SLICE2, get_slice2, set_slice2, cubie::edge::mul, move::p2mask);
+    init_move(move_corners2[0], N_CORNERS, get_corners, set_corners, cubie::corner::mul, move::p2mask);
+    init_move(move_udedges2[0], N_UDEDGES2, get_udedges2, set_udedges2, cubie::edge::mul, move::p2mask);
   }
 
 }
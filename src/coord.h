@@ -25,11 +25,17 @@ namespace coord {
 
   const int SLICE1_SOLVED = 494; // SLICE1 is not 0 at the end of phase 1
 
-  extern uint16_t move_flip[N_FLIP][move::COUNT];
-  extern uint16_t move_twist[N_TWIST][move::COUNT];
-  extern uint16_t move_edges4[N_SLICE][move::COUNT];
-  extern uint16_t move_corners[N_CORNERS][move::COUNT];
-  extern uint16_t move_udedges2[N_UDEDGES2][move::COUNT]; // primarily for faster phase 2 table generation
+  /* Move tables only hold the moves of their phase so that all children of a node are close together */
+
+  extern GENCONST uint16_t move_flip[N_FLIP][move::COUNT_P1];
+  extern GENCONST uint16_t move_twist[N_TWIST][move::COUNT_P1];
+  extern uint16_t move_edges4[N_SLICE][move::COUNT_P1];
+  extern uint16_t move_corners[N_CORNERS][move::COUNT_P1];
+
+  // Indexed by phase 2 move index (see `move::p2moves`)
+  extern uint16_t move_slice2[N_SLICE2][move::COUNT_P2];
+  extern uint16_t move_corners2[N_CORNERS][move::COUNT_P2];
+  extern uint16_t move_udedges2[N_UDEDGES2][move::COUNT_P2];
 
   int get_flip(const cubie::cube& c);
   int get_twist(const cubie::cube& c);
@@ -47,8 +53,20 @@ namespace coord {
 
   int get_slice1(const cubie::cube& c); // faster table generation
   void set_slice1(cubie::cube& c, int slice1);
+  int get_slice2(const cubie::cube& c);
+  void set_slice2(cubie::cube& c, int slice2);
   int get_udedges2(const cubie::cube& c);
   void set_udedges2(cubie::cube& c, int udedges2);
+
+  /* Packed versions for table generation */
+  int get_flip(const cubie::packed& p);
+  int get_twist(const cubie::packed& p);
+  int get_slice(const cubie::packed& p);
+  int get_corners(const cubie::packed& p);
+  int get_slice1(const cubie::packed& p);
+  int get_slice2(const cubie::packed& p);
+  int get_udedges2(const cubie::packed& p);
+
   inline int merge_udedges2(int uedges, int dedges) { return 24 * uedges + (dedges % 24); };
 
   inline int slice_to_slice1(int slice) { return slice / 24; }
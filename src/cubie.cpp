@@ -2,6 +2,10 @@
 
 #include <algorithm>
 #include <random>
+#if defined(__x86_64__) || defined(__i386__)
+  #include <tmmintrin.h>
+  #define SSSE3 __attribute__((target("ssse3")))
+#endif
 #include "coord.h"
 
 namespace cubie {
@@ -135,4 +139,122 @@ namespace cubie {
     return !(c1 == c2);
   }
 
+  const packed PACKED_SOLVED = {
+    {0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15},
+    {0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15}
+  };
+
+  const uint8_t PACKED_MUL_CORI[8][8] = {
+    {0, 1, 2, 0, 4, 5, 6, 0},
+    {1, 2, 0, 0, 5, 6, 4, 0},
+    {2, 0, 1, 0, 6, 4, 5, 0},
+    {0, 0, 0, 0, 0, 0, 0, 0},
+    {4, 6, 5, 0, 0, 2, 1, 0},
+    {5, 4, 6, 0, 1, 0, 2, 0},
+    {6, 5, 4, 0, 2, 1, 0, 0},
+    {0, 0, 0, 0, 0, 0, 0, 0}
+  };
+
+  void pack(const cube& c, packed& into) {
+    into = PACKED_SOLVED; // unused bytes
+    for (int i = 0; i < corner::COUNT; i++)
+      into.corners[i] = c.cperm[i] | (c.cori[i] < 3 ? c.cori[i] : (c.cori[i] - 3) | 0x4) << 4;
+    for (int i = 0; i < edge::COUNT; i++)
+      into.edges[i] = c.eperm[i] | c.eori[i] << 4;
+  }
+
+  void unpack(const packed& p, cube& into) {
+    for (int i = 0; i < corner::COUNT; i++) {
+      into.cperm[i] = p.corners[i] & 0xf;
+      into.cori[i] = (p.corners[i] >> 4 & 0x3) + 3 * (p.corners[i] >> 6);
+    }
+    for (int i = 0; i < edge::COUNT; i++) {
+      into.eperm[i] = p.edges[i] & 0xf;
+      into.eori[i] = p.edges[i] >> 4;
+    }
+  }
+
+  void inv(const packed& p, packed& into) {
+    into = PACKED_SOLVED;
+    for (int i = 0; i < corner::COUNT; i++) {
+      int ori = p.corners[i] >> 4;
+      if (!(ori & 0x4)) // mirrored twists are their own inverse
+        ori = (3 - ori) % 3;
+      into.corners[p.corners[i] & 0xf] = i | ori << 4;
+    }
+    for (int i = 0; i < edge::COUNT; i++)
+      into.edges[p.edges[i] & 0xf] = i | (p.edges[i] & 0x10);
+  }
+
+  #ifdef SSSE3
+    #ifdef __SSSE3__
+      const bool has_ssse3 = true;
+    #else
+      bool detect_ssse3() {
+        __builtin_cpu_init(); // may run before the constructor that usually does this
+        return __builtin_cpu_supports("ssse3");
+      }
+      const bool has_ssse3 = detect_ssse3();
+    #endif
+
+    SSSE3 void mul_corners_ssse3(const packed& p1, const packed& p2, packed& into) {
+      const __m128i low = _mm_set1_epi8(0xf);
+      const __m128i mirror = _mm_set1_epi8(0x4);
+      const __m128i twist = _mm_set1_epi8(0x3);
+      const __m128i neg = _mm_setr_epi8(0, 1, 2, 0, 0, 2, 1, 0, 0, 0, 0, 0, 0, 0, 0, 0);
+      const __m128i mod3 = _mm_setr_epi8(0, 1, 2, 0, 1, 2, 0, 1, 2, 0, 1, 2, 0, 1, 2, 0);
+
+      __m128i c1 = _mm_load_si128((const __m128i*) p1.corners);
+      __m128i c2 = _mm_load_si128((const __m128i*) p2.corners);
+      __m128i c = _mm_shuffle_epi8(c1, _mm_and_si128(c2, low));
+      __m128i ori1 = _mm_and_si128(_mm_srli_epi16(c, 4), low);
+      __m128i ori2 = _mm_and_si128(_mm_srli_epi16(c2, 4), low);
+      // Twist of `p2` is subtracted if the corner of `p1` is mirrored
+      __m128i twist2 = _mm_shuffle_epi8(
+        neg, _mm_or_si128(_mm_and_si128(ori2, twist), _mm_and_si128(ori1, mirror))
+      );
+      __m128i ori = _mm_shuffle_epi8(mod3, _mm_add_epi8(_mm_and_si128(ori1, twist), twist2));
+      ori = _mm_or_si128(ori, _mm_and_si128(_mm_xor_si128(ori1, ori2), mirror));
+      _mm_store_si128((__m128i*) into.corners, _mm_or_si128(_mm_and_si128(c, low), _mm_slli_epi16(ori, 4)));
+    }
+
+    SSSE3 void mul_edges_ssse3(const packed& p1, const packed& p2, packed& into) {
+      const __m128i low = _mm_set1_epi8(0xf);
+      __m128i e1 = _mm_load_si128((const __m128i*) p1.edges);
+      __m128i e2 = _mm_load_si128((const __m128i*) p2.edges);
+      __m128i e = _mm_shuffle_epi8(e1, _mm_and_si128(e2, low));
+      // Flipping is just a XOR of the orientation bit
+      _mm_store_si128((__m128i*) into.edges, _mm_xor_si128(e, _mm_andnot_si128(low, e2)));
+    }
+  #endif
+
+  void corner::mul(const packed& p1, const packed& p2, packed& into) {
+    #ifdef SSSE3
+      if (has_ssse3) {
+        mul_corners_ssse3(p1, p2, into);
+        return;
+      }
+    #endif
+    for (int i = 0; i < corner::COUNT; i++) {
+      int c = p1.corners[p2.corners[i] & 0xf];
+      into.corners[i] = (c & 0xf) | PACKED_MUL_CORI[c >> 4][p2.corners[i] >> 4] << 4;
+    }
+  }
+
+  void edge::mul(const packed& p1, const packed& p2, packed& into) {
+    #ifdef SSSE3
+      if (has_ssse3) {
+        mul_edges_ssse3(p1, p2, into);
+        return;
+      }
+    #endif
+    for (int i = 0; i < edge::COUNT; i++)
+      into.edges[i] = p1.edges[p2.edges[i] & 0xf] ^ (p2.edges[i] & 0x10);
+  }
+
+  void mul(const packed& p1, const packed& p2, packed& into) {
+    corner::mul(p1, p2, into);
+    edge::mul(p1, p2, into);
+  }
+
 }
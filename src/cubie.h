@@ -5,7 +5,12 @@
 #ifndef __CUBIE__
 #define __CUBIE__
 
+#include <algorithm>
+#include <cstdint>
 #include <string>
+#ifdef __SSE2__
+  #include <emmintrin.h>
+#endif
 
 namespace cubie {
 
@@ -78,10 +83,57 @@ namespace cubie {
   void inv(const cube& c, cube& into); // compute the inverse cube
   void shuffle(cube& c); // generate a uniformly random cube
   int check(const cube& c); // check a cube for being solvable
+  bool parity(const int perm[], int len); // permutation parity
 
   bool operator==(const cube& c1, const cube& c2);
   bool operator!=(const cube& c1, const cube& c2);
 
+  /* Byte-packed cube for the many multiplications during table generation. Cubie `i` is stored in byte `i` of
+   * `corners` / `edges` as perm | ori << 4, mirrored corner orientations 3-5 are stored as (ori - 3) | 4 s.t. bits 4-5
+   * are always the actual twist. Unused bytes simply hold their own index, thereby making multiplication a plain
+   * shuffle (pshufb with SSSE3) over all 16 bytes of each half. */
+
+  struct packed {
+    alignas(16) uint8_t corners[16];
+    alignas(16) uint8_t edges[16];
+  };
+
+  void pack(const cube& c, packed& into);
+  void unpack(const packed& p, cube& into);
+  void inv(const packed& p, packed& into);
+
+  extern const packed PACKED_SOLVED;
+  extern const uint8_t PACKED_MUL_CORI[8][8]; // `mul_coris` in packed encoding
+
+  /* Packed multiplication; on x86 the SSSE3 versions are selected at runtime s.t. the default build (which cannot
+   * assume SSSE3) uses them as well */
+  namespace corner {
+    void mul(const packed& p1, const packed& p2, packed& into);
+  }
+  namespace edge {
+    void mul(const packed& p1, const packed& p2, packed& into);
+  }
+  void mul(const packed& p1, const packed& p2, packed& into);
+
+  inline bool operator==(const packed& p1, const packed& p2) {
+    #ifdef __SSE2__ // always available on x86-64
+      __m128i c = _mm_cmpeq_epi8(
+        _mm_load_si128((const __m128i*) p1.corners), _mm_load_si128((const __m128i*) p2.corners)
+      );
+      __m128i e = _mm_cmpeq_epi8(_mm_load_si128((const __m128i*) p1.edges), _mm_load_si128((const __m128i*) p2.edges));
+      return _mm_movemask_epi8(_mm_and_si128(c, e)) == 0xffff;
+    #else
+      return
+        std::equal(p1.corners, p1.corners + corner::COUNT, p2.corners) &&
+        std::equal(p1.edges, p1.edges + edge::COUNT, p2.edges)
+      ;
+    #endif
+  }
+
+  inline bool operator!=(const packed& p1, const packed& p2) {
+    return !(p1 == p2);
+  }
+
 }
 
 #endif
@@ -0,0 +1,83 @@
+/**
+ * Build-time generator for the small fixed tables of the configured solving mode. These are emitted as constant
+ * definitions included by the individual modules s.t. they end up in read-only data and need no work at startup.
+ *
+ * Usage: gentables coord|move|sym > src/gen/MODULE.inc
+ */
+
+#include <algorithm>
+#include <cstdio>
+#include <string>
+
+#include "coord.h"
+#include "move.h"
+#include "sym.h"
+
+namespace coord {
+  extern uint8_t enc_perm[];
+  extern uint8_t dec_perm[];
+  extern uint16_t enc_comb[];
+  extern uint16_t dec_comb[];
+}
+
+std::string str(uint64_t val, bool hex) {
+  char buf[32];
+  if (hex)
+    snprintf(buf, sizeof(buf), "0x%llxull", (unsigned long long) val);
+  else
+    snprintf(buf, sizeof(buf), "%llu", (unsigned long long) val);
+  return buf;
+}
+
+// Print `data` as a 2D array if `rows` > 1 and otherwise with 16 entries per line; `decl` is the definition without
+// `const`
+template <typename T>
+void print(const std::string& decl, const T *data, int rows, int cols, bool hex = false) {
+  int per_line = rows > 1 ? cols : 16;
+  int n = rows * cols;
+
+  printf("  const %s = {\n", decl.c_str());
+  for (int i = 0; i < n; i += per_line) {
+    std::string line;
+    for (int j = i; j < std::min(i + per_line, n); j++)
+      line += (j > i ? ", " : "") + str(data[j], hex);
+    if (rows > 1)
+      line = "{" + line + "}";
+    printf("    %s%s\n", line.c_str(), i + per_line < n ? "," : "");
+  }
+  printf("  };\n\n");
+}
+
+int main(int argc, char *argv[]) {
+  if (argc != 2) {
+    fprintf(stderr, "Usage: %s coord|move|sym\n", argv[0]);
+    return 1;
+  }
+  std::string module = argv[1];
+
+  move::init();
+  coord::init();
+  sym::init();
+
+  printf("// Generated by `gentables %s` for the configured solving mode, do not edit\n\n", module.c_str());
+  if (module == "coord") {
+    print("uint16_t move_flip[N_FLIP][move::COUNT_P1]", coord::move_flip[0], coord::N_FLIP, move::COUNT_P1);
+    print("uint16_t move_twist[N_TWIST][move::COUNT_P1]", coord::move_twist[0], coord::N_TWIST, move::COUNT_P1);
+    print("uint8_t enc_perm[1 << (4 * 2)]", coord::enc_perm, 1, 1 << (4 * 2));
+    print("uint8_t dec_perm[N_PERM4]", coord::dec_perm, 1, 24);
+    print("uint16_t enc_comb[1 << 12]", coord::enc_comb, 1, 1 << 12);
+    print("uint16_t dec_comb[N_C12K4]", coord::dec_comb, 1, 495);
+  } else if (module == "move") {
+    print("mask next[COUNT]", move::next, 1, move::COUNT, true);
+    print("mask qt_skip[COUNT]", move::qt_skip, 1, move::COUNT, true);
+  } else if (module == "sym") {
+    print("int inv[COUNT]", sym::inv, 1, sym::COUNT);
+    print("int effect[COUNT][3]", sym::effect[0], sym::COUNT, 3);
+    print("int conj_move[move::COUNT][COUNT]", sym::conj_move[0], move::COUNT, sym::COUNT);
+  } else {
+    fprintf(stderr, "Unknown module %s\n", module.c_str());
+    return 1;
+  }
+
+  return 0;
+}
@@ -0,0 +1,201 @@
+#include "huff.h"
+
+#include <algorithm>
+#include <cstring>
+#include <queue>
+
+namespace huff {
+
+  const int MAX_LEN = 12; // maximum code length, keeps the decoding table small enough for L1
+  const int PAD = 8; // zero bytes after each bitstream s.t. the decoder can always load 8 bytes at once
+
+  // Lane storage modes
+  enum { RAW, CODED };
+
+  // Lengths of a Huffman code limited to `MAX_LEN` for `freqs` (0 for unused symbols)
+  void code_lens(const uint64_t freqs[256], int lens[256]) {
+    uint64_t freqs1[256];
+    std::copy(freqs, freqs + 256, freqs1);
+
+    while (true) {
+      // Nodes 0 - 255 are the symbols, merged nodes follow
+      using item = std::pair<uint64_t, int>;
+      std::priority_queue<item, std::vector<item>, std::greater<item>> heap;
+      int parent[511];
+      for (int sym = 0; sym < 256; sym++) {
+        if (freqs1[sym])
+          heap.emplace(freqs1[sym], sym);
+      }
+      int n = 256;
+      while (heap.size() > 1) {
+        auto a = heap.top();
+        heap.pop();
+        auto b = heap.top();
+        heap.pop();
+        parent[a.second] = n;
+        parent[b.second] = n;
+        heap.emplace(a.first + b.first, n++);
+      }
+      int root = heap.empty() ? -1 : heap.top().second;
+
+      int max_len = 0;
+      for (int sym = 0; sym < 256; sym++) {
+        lens[sym] = 0;
+        if (!freqs1[sym])
+          continue;
+        for (int node = sym; node != root; node = parent[node])
+          lens[sym]++;
+        lens[sym] = std::max(lens[sym], 1); // a single symbol still needs one bit
+        max_len = std::max(max_len, lens[sym]);
+      }
+      if (max_len <= MAX_LEN)
+        return;
+
+      // Flatten the distribution until the code is short enough; this costs very little compression in practice
+      for (int sym = 0; sym < 256; sym++) {
+        if (freqs1[sym])
+          freqs1[sym] = (freqs1[sym] >> 1) | 1;
+      }
+    }
+  }
+
+  // Canonical codes for `lens` with bits reversed as the stream is written starting from the least significant bit
+  void canonical(const int lens[256], uint32_t codes[256]) {
+    uint32_t code = 0;
+    for (int len = 1; len <= MAX_LEN; len++) {
+      for (int sym = 0; sym < 256; sym++) {
+        if (lens[sym] != len)
+          continue;
+        uint32_t rev = 0;
+        for (int i = 0; i < len; i++)
+          rev |= ((code >> i) & 1) << (len - 1 - i);
+        codes[sym] = rev;
+        code++;
+      }
+      code <<= 1;
+    }
+  }
+
+  std::vector<uint8_t> encode(const uint8_t *data, size_t size, int width) {
+    std::vector<uint8_t> out;
+
+    for (int lane = 0; lane < width; lane++) {
+      uint64_t freqs[256] = {};
+      for (size_t i = lane; i < size; i += width)
+        freqs[data[i]]++;
+      int lens[256];
+      code_lens(freqs, lens);
+      uint32_t codes[256];
+      canonical(lens, codes);
+
+      std::vector<uint8_t> bits;
+      uint64_t acc = 0;
+      int n_acc = 0;
+      for (size_t i = lane; i < size; i += width) {
+        acc |= uint64_t(codes[data[i]]) << n_acc;
+        n_acc += lens[data[i]];
+        for (; n_acc >= 8; n_acc -= 8, acc >>= 8)
+          bits.push_back(acc & 0xff);
+      }
+      if (n_acc > 0)
+        bits.push_back(acc & 0xff);
+
+      size_t n_lane = (size - lane + width - 1) / width;
+      uint32_t len = bits.size();
+      if (len + 128 >= n_lane) { // not worth it (only happens for almost random lanes)
+        out.push_back(RAW);
+        for (size_t i = lane; i < size; i += width)
+          out.push_back(data[i]);
+        continue;
+      }
+
+      out.push_back(CODED);
+      for (int sym = 0; sym < 256; sym += 2)
+        out.push_back(lens[sym] | lens[sym + 1] << 4); // lengths are at most 12, i.e. fit into 4 bits
+      out.insert(out.end(), (uint8_t *) &len, (uint8_t *) &len + sizeof(len));
+      out.insert(out.end(), bits.begin(), bits.end());
+      out.insert(out.end(), PAD, 0);
+    }
+
+    return out;
+  }
+
+  size_t max_size(size_t size, int width) {
+    // A raw lane is its bytes plus the mode; a coded one is only used if its bitstream is > 128 bytes shorter, which
+    // leaves the mode, the length and the padding
+    return size + width * (1 + sizeof(uint32_t) + PAD);
+  }
+
+  bool decode(const uint8_t *in, size_t in_size, uint8_t *out, size_t size, int width) {
+    const uint8_t *end = in + in_size;
+
+    for (int lane = 0; lane < width; lane++) {
+      size_t n_lane = (size - lane + width - 1) / width;
+      if (end - in < 1)
+        return true;
+
+      if (*in++ == RAW) {
+        if (size_t(end - in) < n_lane)
+          return true;
+        for (size_t i = 0; i < n_lane; i++)
+          out[lane + width * i] = in[i];
+        in += n_lane;
+        continue;
+      }
+
+      if (size_t(end - in) < 128 + sizeof(uint32_t))
+        return true;
+      int lens[256];
+      for (int sym = 0; sym < 256; sym += 2) {
+        lens[sym] = *in & 0xf;
+        lens[sym + 1] = *in++ >> 4;
+      }
+      if (*std::max_element(lens, lens + 256) > MAX_LEN)
+        return true;
+      uint32_t len;
+      memcpy(&len, in, sizeof(len));
+      in += sizeof(len);
+      if (size_t(end - in) < size_t(len) + PAD)
+        return true;
+
+      // Every `MAX_LEN` bit prefix directly gives the next symbol and its code length (0 marks an invalid code)
+      uint32_t codes[256];
+      canonical(lens, codes);
+      uint16_t table[1 << MAX_LEN] = {};
+      for (int sym = 0; sym < 256; sym++) {
+        if (!lens[sym])
+          continue;
+        for (uint32_t i = codes[sym]; i < (1 << MAX_LEN); i += 1 << lens[sym])
+          table[i] = sym | lens[sym] << 8;
+      }
+
+      // A single load gives at least 56 valid bits, i.e. enough for 4 codes
+      uint64_t pos = 0;
+      uint64_t lim = 8 * uint64_t(len);
+      uint8_t *lane_out = out + lane;
+      size_t i = 0;
+      while (i < n_lane) {
+        if (pos > lim)
+          return true; // make sure to never read beyond the padding
+        uint64_t bits;
+        memcpy(&bits, in + (pos >> 3), sizeof(bits));
+        bits >>= pos & 7;
+        int n = int(std::min(n_lane - i, size_t(4)));
+        for (int j = 0; j < n; j++) {
+          int entry = table[bits & ((1 << MAX_LEN) - 1)];
+          if (!(entry >> 8))
+            return true;
+          lane_out[width * i++] = entry & 0xff;
+          bits >>= entry >> 8;
+          pos += entry >> 8;
+        }
+      }
+      if (pos > lim)
+        return true;
+      in += len + PAD;
+    }
+
+    return in != end; // block must be consumed exactly
+  }
+
+}
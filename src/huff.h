@@ -0,0 +1,26 @@
+/**
+ * Small self-contained block codec for the on-disk pruning tables. Table entries consist mostly of few distinct
+ * values per byte position (distances, sparse move-masks), hence every block is split into byte lanes (all bytes at
+ * the same offset within an entry of `width` bytes) which are then individually Huffman coded. Blocks are fully
+ * independent s.t. they can be encoded and decoded in parallel.
+ */
+
+#ifndef __HUFF__
+#define __HUFF__
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace huff {
+
+  // Compresses `size` bytes of entries with `width` bytes each
+  std::vector<uint8_t> encode(const uint8_t *data, size_t size, int width);
+  // Upper bound for the size of any encoded block of `size` bytes (s.t. corrupt files can be rejected early)
+  size_t max_size(size_t size, int width);
+  // Decompresses exactly `size` bytes; returns true if the block is corrupt
+  bool decode(const uint8_t *in, size_t in_size, uint8_t *out, size_t size, int width);
+
+}
+
+#endif
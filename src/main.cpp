@@ -4,12 +4,17 @@
 #include <iostream>
 #include <vector>
 #include <numeric>
+#include <thread>
+#include <unistd.h>
 
 #include "cubie.h"
 #include "coord.h"
 #include "face.h"
 #include "move.h"
+#include "numa.h"
+#include "proto.h"
 #include "prun.h"
+#include "server.h"
 #include "solve.h"
 #include "sym.h"
 
@@ -17,12 +22,12 @@ const std::string BENCH_FILE = "bench.cubes";
 
 void usage() {
   std::cout << "Usage: ./twophase "
-    << "[-c] [-l MAX_LEN = 1] [-m MILLIS = 10] [-n N_SOLS = 1] [-s N_SPLITS = 1] [-t N_THREADS = 1] [-w N_WARMUPS = 0]"
+    << "[-a] [-b] [-c] [-d] [-e FACES] [-f FACES] [-g MEGABYTES] [-i PLACEMENT] [-j N_WORKERS = 1] [-k N_CORES] [-l MAX_LEN = 1] [-m MILLIS = 10] [-n N_SOLS = 1] [-o] [-p] [-r] [-s N_SPLITS = 1] [-t N_THREADS = 1] [-u SOCKET] [-v] [-w N_WARMUPS = 0] [-x] [-z]"
   << std::endl;
   exit(1);
 }
 
-void init() {
+void init(bool progressive, bool lowmem, bool phase2raw, bool phase2x, bool phase2next) {
   auto tick = std::chrono::high_resolution_clock::now();
   std::cout << "Loading tables ..." << std::endl;
 
@@ -30,10 +35,31 @@ void init() {
   move::init();
   coord::init();
   sym::init();
-  if (prun::init(true)) {
-    std::cout << "Error." << std::endl;
-    exit(1);
-  }
+  auto full = [=]() {
+    if (
+      prun::init(true, lowmem) || (phase2x && prun::init_phase2x(true)) || (phase2next && prun::init_phase2next(true))
+    ) {
+      std::cout << "Error." << std::endl;
+      exit(1);
+    }
+    if (phase2raw)
+      prun::init_phase2raw();
+    if (prun::interleave()) // only does something with `-i interleave`
+      std::cout << "Warning: Could not interleave the tables (-i); they stay where they were loaded." << std::endl;
+  };
+
+  if (progressive) {
+    // Solve with the weak tables right away and switch once the full ones are loaded (or generated)
+    prun::init_weak();
+    std::thread([=]() {
+      full();
+      prun::ready = true;
+      std::cout << "Full tables ready. " << std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::high_resolution_clock::now() - tick
+      ).count() / 1000. << "s" << std::endl;
+    }).detach();
+  } else
+    full();
 
   std::cout << "Done. " << std::chrono::duration_cast<std::chrono::milliseconds>(
     std::chrono::high_resolution_clock::now() - tick
@@ -58,16 +84,16 @@ void warmup(solve::Engine& solver, int count) {
 }
 
 bool check(const cubie::cube &c, const std::vector<int>& sol) {
-  cubie::cube c1;
-  cubie::cube c2;
+  cubie::packed p1;
+  cubie::packed p2;
 
-  c1 = c;
+  cubie::pack(c, p1);
   for (int m : sol) {
-    cubie::mul(c1, move::cubes[m], c2);
-    std::swap(c1, c2);
+    cubie::mul(p1, move::pcubes[m], p2);
+    std::swap(p1, p2);
   }
 
-  return c1 == cubie::SOLVED_CUBE;
+  return p1 == cubie::PACKED_SOLVED;
 }
 
 double mean(const std::vector<std::vector<int>>& sols, int (*len)(const std::vector<int>&)) {
@@ -83,16 +109,73 @@ int main(int argc, char *argv[]) {
   int n_sols = 1;
   int max_len = -1;
   int n_splits = 1;
+  int n_workers = 1;
+  int n_cores = 0;
+  int policy = solve::FAIR;
+  int placement = numa::NONE;
+  bool binary = false;
   bool compress = false;
+  int gen_mem = 0;
+  bool lowmem = false;
+  bool order = false;
+  bool progressive = false;
+  bool phase2raw = false;
+  bool phase2x = false;
+  bool phase2next = false;
+  bool save_z = false;
   int n_warmups = 0;
+  move::mask first = ~move::mask(0);
+  move::mask last = ~move::mask(0);
+  std::string first_faces;
+  std::string last_faces;
+  std::string socket;
 
   try {
     int opt;
-    while ((opt = getopt(argc, argv, "cl:m:n:s:t:w:")) != -1) {
+    while ((opt = getopt(argc, argv, "abcde:f:g:i:j:k:l:m:n:oprs:t:u:vw:xz")) != -1) {
       switch (opt) {
+        case 'a':
+          policy = solve::DEADLINE;
+          break;
+        case 'b':
+          binary = true;
+          break;
         case 'c':
           compress = true;
           break;
+        case 'd':
+          lowmem = true;
+          break;
+        case 'e':
+          last_faces = optarg;
+          break;
+        case 'f':
+          first_faces = optarg;
+          break;
+        case 'g':
+          if ((gen_mem = std::stoi(optarg)) <= 0) {
+            std::cout << "Error: Generation memory (-g) must be >= 1 MB." << std::endl;
+            return 1;
+          }
+          break;
+        case 'i':
+          if ((placement = numa::parse(optarg)) < 0) {
+            std::cout << "Error: Placement (-i) must be one of pin, interleave or auto." << std::endl;
+            return 1;
+          }
+          break;
+        case 'j':
+          if ((n_workers = std::stoi(optarg)) <= 0) {
+            std::cout << "Error: Number of daemon workers (-j) must be >= 1." << std::endl;
+            return 1;
+          }
+          break;
+        case 'k':
+          if ((n_cores = std::stoi(optarg)) <= 0) {
+            std::cout << "Error: Number of shared cores (-k) must be >= 1." << std::endl;
+            return 1;
+          }
+          break;
         case 'l':
           max_len = std::stoi(optarg);
           break;
@@ -105,6 +188,15 @@ int main(int argc, char *argv[]) {
             return 1;
           }
           break;
+        case 'o':
+          order = true;
+          break;
+        case 'p':
+          progressive = true;
+          break;
+        case 'r':
+          phase2raw = true;
+          break;
         case 's':
           if ((n_splits = std::stoi(optarg)) <= 0) {
             std::cout << "Error: Number of job splits (-s) must be >= 1." << std::endl;
@@ -117,12 +209,24 @@ int main(int argc, char *argv[]) {
             return 1;
           }
           break;
+        case 'u':
+          socket = optarg;
+          break;
+        case 'v':
+          phase2next = true;
+          break;
         case 'w':
           if ((n_warmups = std::stoi(optarg)) <= 0) {
             std::cout << "Error: Number of warmup solves (-w) must be >= 0." << std::endl;
             return 1;
           }
           break;
+        case 'x':
+          phase2x = true;
+          break;
+        case 'z':
+          save_z = true;
+          break;
         default:
           usage();
       }
@@ -131,11 +235,102 @@ int main(int argc, char *argv[]) {
     usage();
   }
 
+  if (binary && !socket.empty()) {
+    std::cout << "Error: Binary mode (-b) and daemon mode (-u) are exclusive." << std::endl;
+    return 1;
+  }
+
+  if (lowmem && phase2raw) {
+    std::cout << "Error: The raw phase 2 table (-r) is derived from the full tables and thus not available with -d." << std::endl;
+    return 1;
+  }
+
+  if (lowmem && phase2next) {
+    std::cout << "Error: The phase 2 move-masks (-v) are derived from the full tables and thus not available with -d." << std::endl;
+    return 1;
+  }
+
+  // In binary mode, stdout carries only protocol records; all text output goes to stderr instead
+  int binary_out = 1;
+  if (binary) {
+    binary_out = dup(1);
+    dup2(2, 1);
+  }
+
   std::cout << "This is rob-twophase v2.0; copyright Elias Frantar 2020." << std::endl << std::endl;
-  init();
-  solve::Engine solver(n_threads, tlim, n_sols, max_len, n_splits);
+  if (gen_mem > 0) {
+    std::cout << "Generating tables ..." << std::endl;
+    face::init();
+    move::init();
+    coord::init();
+    sym::init();
+    if (prun::generate(int64_t(gen_mem) << 20)) {
+      std::cout << "Error." << std::endl;
+      return 1;
+    }
+    std::cout << "Done." << std::endl;
+    return 0;
+  }
+
+  if (lowmem && save_z) {
+    std::cout << "Error: Only the default tables can be compressed (-z), not the ones of -d." << std::endl;
+    return 1;
+  }
+
+  if (progressive && save_z) {
+    std::cout << "Error: Compressing tables (-z) needs them to be fully loaded, i.e. cannot be combined with -p." << std::endl;
+    return 1;
+  }
+
+  if (placement != numa::NONE) {
+    placement = numa::init(placement);
+    if (placement == numa::NONE)
+      std::cout << "Warning: Could not pin threads (-i); NUMA placement is disabled." << std::endl << std::endl;
+    else {
+      std::cout << "Found " << numa::n_nodes() << " NUMA node(s); pinning threads"
+        << (placement == numa::INTERLEAVE ? " and interleaving tables." : ".") << std::endl << std::endl;
+    }
+  }
+  init(progressive, lowmem, phase2raw, phase2x, phase2next);
+  if (save_z) {
+    std::cout << "Compressing tables ..." << std::endl;
+    if (prun::save_compressed()) {
+      std::cout << "Error." << std::endl;
+      return 1;
+    }
+    std::cout << "Done." << std::endl;
+    return 0;
+  }
+
+  // Move names are only available after initialization
+  if (!first_faces.empty() && (first = move::faces(first_faces)) == 0) {
+    std::cout << "Error: First move faces (-f) must be a subset of UDRLFB (other than just B with -DF5)." << std::endl;
+    return 1;
+  }
+  if (!last_faces.empty() && (last = move::faces(last_faces)) == 0) {
+    std::cout << "Error: Last move faces (-e) must be a subset of UDRLFB (other than just B with -DF5)." << std::endl;
+    return 1;
+  }
+
+  if (n_cores > 0)
+    solve::share(n_cores, policy);
+  if (!socket.empty()) {
+    server::run(socket, n_workers, [=]() {
+      return new solve::Engine(n_threads, tlim, n_sols, max_len, n_splits, order);
+    }, first, last);
+    return 1; // only returns on errors
+  }
+
+  solve::Engine solver(n_threads, tlim, n_sols, max_len, n_splits, order);
   warmup(solver, n_warmups);
 
+  if (binary) {
+    std::cout << "Serving binary requests on stdin." << std::endl;
+    proto::serve(solver, 0, binary_out, first, last);
+    solver.finish();
+    return 0;
+  }
+
   std::cout << "Enter >>solve FACECUBE<< to solve, >>scramble<< to scramble or >>bench<< to benchmark." << std::endl << std::endl;
 
   std::string mode;
@@ -162,7 +357,7 @@ int main(int argc, char *argv[]) {
         }
 
         std::vector<std::vector<int>> sols;
-        std::vector<int> times(cubes.size());
+        std::vector<double> times(cubes.size());
         int failed = 0;
 
         std::cout << "Benchmarking ..." << std::endl;
@@ -172,7 +367,7 @@ int main(int argc, char *argv[]) {
           solver.prepare();
           auto tick = std::chrono::high_resolution_clock::now();
           std::vector<std::vector<int>> tmp;
-          solver.solve(cubes[i], tmp);
+          solver.solve(cubes[i], tmp, first, last);
           times[i] = std::chrono::duration_cast<std::chrono::microseconds>(
             std::chrono::high_resolution_clock::now() - tick
           ).count() / 1000.;
@@ -242,7 +437,7 @@ int main(int argc, char *argv[]) {
       }
 
       auto tick = std::chrono::high_resolution_clock::now();
-      solver.solve(c, sols);
+      solver.solve(c, sols, first, last);
       std::cout << std::chrono::duration_cast<std::chrono::microseconds>(
         std::chrono::high_resolution_clock::now() - tick
       ).count() / 1000. << "ms" << std::endl;
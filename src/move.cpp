@@ -56,11 +56,20 @@ namespace move {
 
   std::string names[COUNT];
   cubie::cube cubes[COUNT];
+  cubie::packed pcubes[COUNT];
   int inv[COUNT];
 
-  mask next[COUNT];
+  #ifdef GENTABLES
+    mask next[COUNT];
+    mask qt_skip[COUNT];
+  #else
+    #include "gen/move.inc"
+  #endif
+
+  int p2moves[COUNT_P2];
+  mask next2[COUNT_P2];
+  mask qt_skip2[COUNT_P2];
   mask next_p1p2[COUNT];
-  mask qt_skip[COUNT];
 
   mask p1mask = bit(45) - 1;
   mask p2mask = 0x10482097fff; // 000010000 010010 000010000 010010 111111111 111111;
@@ -80,6 +89,15 @@ namespace move {
     return mm1;
   }
 
+  mask to_p2(mask mm) {
+    mask mm1 = 0;
+    for (int i = 0; i < COUNT_P2; i++) {
+      if (in(p2moves[i], mm))
+        mm1 |= bit(i);
+    }
+    return mm1;
+  }
+
   // Build full moveset first, then remap to configured one
   void init() {
     for (int m = 0; m < 45; m++) {
@@ -210,9 +228,12 @@ namespace move {
 
       names[i] = names1[m];
       cubes[i] = cubes1[m];
+      cubie::pack(cubes[i], pcubes[i]);
       inv[i] = map[inv1[m]];
-      next[i] = reindex(next1[m]);
-      qt_skip[i] = reindex(qt_skip1[m]);
+      #ifdef GENTABLES
+        next[i] = reindex(next1[m]);
+        qt_skip[i] = reindex(qt_skip1[m]);
+      #endif
     }
 
     #ifdef QT
@@ -227,6 +248,16 @@ namespace move {
     p1mask = reindex(p1mask);
     p2mask = reindex(p2mask);
 
+    int i = 0;
+    for (int m = 0; m < COUNT; m++) {
+      if (in(m, p2mask))
+        p2moves[i++] = m;
+    }
+    for (i = 0; i < COUNT_P2; i++) {
+      next2[i] = to_p2(next[p2moves[i]]);
+      qt_skip2[i] = to_p2(qt_skip[p2moves[i]]);
+    }
+
     for (int m = 0; m < COUNT; m++) {
       if (p2mask & move::bit(m))
         next_p1p2[m] = next[m]; // we can do normal blocking for phase 2 moves
@@ -243,6 +274,7 @@ namespace move {
           next_p1p2[m] = next[m]; // no commutativity problems in axial mode
         #endif
       }
+      next_p1p2[m] = to_p2(next_p1p2[m]);
     }
 
     cubie::cube c;
@@ -260,6 +292,18 @@ namespace move {
     }
   }
 
+  mask faces(const std::string& faces) {
+    if (faces.empty() || faces.find_first_not_of("UDRLFB") != std::string::npos)
+      return 0;
+
+    mask mm = 0;
+    for (int m = 0; m < COUNT; m++) {
+      if (names[m].find_first_of(faces) != std::string::npos)
+        mm |= bit(m);
+    }
+    return mm & (p1mask | p2mask); // the B-moves of F5 mode are never used in search
+  }
+
   void compress1(const std::vector<int>& mseq, std::vector<int>& into) {
     into.clear();
     for (int m : mseq) {
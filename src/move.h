@@ -11,6 +11,13 @@
 
 #include "cubie.h"
 
+// Small fixed tables are generated at build time (see `gentables.cpp`) and are only computed when building the generator
+#ifdef GENTABLES
+  #define GENCONST
+#else
+  #define GENCONST const
+#endif
+
 namespace move {
 
   using mask = uint64_t;
@@ -41,13 +48,58 @@ namespace move {
     #endif
   #endif
 
+  /* Number of moves used in phase 1 (always the first ones) and phase 2; B-moves are dead in F5-mode */
+  #ifdef F5
+    #ifdef QT
+      #ifdef AX
+        const int COUNT_P1 = 18;
+        const int COUNT_P2 = 12;
+      #else
+        const int COUNT_P1 = 10;
+        const int COUNT_P2 = 7;
+      #endif
+    #else
+      #ifdef AX
+        const int COUNT_P1 = 33;
+        const int COUNT_P2 = 19;
+      #else
+        const int COUNT_P1 = 15;
+        const int COUNT_P2 = 9;
+      #endif
+    #endif
+  #else
+    #ifdef QT
+      #ifdef AX
+        const int COUNT_P1 = 24;
+        const int COUNT_P2 = 14;
+      #else
+        const int COUNT_P1 = 12;
+        const int COUNT_P2 = 8;
+      #endif
+    #else
+      #ifdef AX
+        const int COUNT_P1 = 45;
+        const int COUNT_P2 = 21;
+      #else
+        const int COUNT_P1 = 18;
+        const int COUNT_P2 = 10;
+      #endif
+    #endif
+  #endif
+
   extern std::string names[COUNT];
   extern cubie::cube cubes[COUNT];
+  extern cubie::packed pcubes[COUNT]; // `cubes` for fast table generation
   extern int inv[COUNT];
 
-  extern mask next[COUNT]; // successor moves that should be explored
-  extern mask next_p1p2[COUNT]; // `next` for phase1 to phase 2 transition
-  extern mask qt_skip[COUNT]; // to avoid ever trying M^3 = M' in QT mode
+  extern GENCONST mask next[COUNT]; // successor moves that should be explored
+  extern GENCONST mask qt_skip[COUNT]; // to avoid ever trying M^3 = M' in QT mode
+
+  /* Phase 2 works only with the `COUNT_P2` phase 2 moves, hence all its masks are indexed by those */
+  extern int p2moves[COUNT_P2]; // phase 2 move index -> move
+  extern mask next2[COUNT_P2]; // `next` for phase 2
+  extern mask qt_skip2[COUNT_P2]; // `qt_skip` for phase 2
+  extern mask next_p1p2[COUNT]; // `next2` for phase1 to phase 2 transition
 
   extern mask p1mask; // phase 1 moves
   extern mask p2mask; // phase 2 moves
@@ -59,6 +111,13 @@ namespace move {
     return mm & bit(m);
   }
 
+  // Translate mask over all moves to one over phase 2 moves (dropping all others)
+  mask to_p2(mask mm);
+
+  /* Mask of all moves turning any of the given faces (e.g. "UD" for the full U/D-axis); 0 if `faces` is invalid or
+   * no searched move turns any of them (i.e. only B in F5 mode) */
+  mask faces(const std::string& faces);
+
   // Convert solution to AXHT; especially useful when solving in AXQT
   std::string compress(const std::vector<int>& mseq);
 
@@ -0,0 +1,147 @@
+#include "numa.h"
+
+#include <atomic>
+#include <fstream>
+#include <iostream>
+#include <sched.h>
+#include <sstream>
+#include <sys/syscall.h>
+#include <unistd.h>
+#include <vector>
+
+namespace numa {
+
+  // From the kernel's `mempolicy.h`, so that we do not need `libnuma` just for one syscall
+  const int MPOL_INTERLEAVE = 3;
+  const int MPOL_MF_MOVE = 1 << 1;
+  const int MAX_NODES = 1024;
+  const int BITS = 8 * sizeof(unsigned long);
+
+  int policy = NONE;
+  unsigned long mem_nodes[MAX_NODES / BITS];
+  std::vector<std::vector<int>> node_cpus;
+  std::vector<int> cpus; // CPU of every slot, alternating between the nodes
+  std::atomic<int> next_slot(0);
+  std::atomic<bool> pin_failed(false);
+
+  int parse(const std::string& s) {
+    if (s == "pin")
+      return PIN;
+    if (s == "interleave")
+      return INTERLEAVE;
+    if (s == "auto")
+      return AUTO;
+    return -1;
+  }
+
+  size_t n_cpus() {
+    size_t n = 0;
+    for (auto& list : node_cpus)
+      n += list.size();
+    return n;
+  }
+
+  // Parse a kernel CPU list like "0-11,24-35"
+  std::vector<int> parse_list(const std::string& s) {
+    std::vector<int> list;
+    std::stringstream ss(s);
+    std::string range;
+    while (std::getline(ss, range, ',')) {
+      int first;
+      int last;
+      char dash;
+      std::stringstream rs(range);
+      if (!(rs >> first))
+        continue;
+      if (!(rs >> dash >> last))
+        last = first;
+      for (int cpu = first; cpu <= last; cpu++)
+        list.push_back(cpu);
+    }
+    return list;
+  }
+
+  int init(int policy1) {
+    cpu_set_t allowed; // e.g. restricted by `taskset` or a container's cpuset
+    bool known = sched_getaffinity(0, sizeof(allowed), &allowed) == 0;
+    for (int node = 0; node < MAX_NODES; node++) {
+      std::ifstream f("/sys/devices/system/node/node" + std::to_string(node) + "/cpulist");
+      if (!f)
+        continue; // node IDs need not be consecutive
+      std::string s;
+      std::getline(f, s);
+      std::vector<int> list;
+      for (int cpu : parse_list(s)) {
+        if (!known || (cpu < CPU_SETSIZE && CPU_ISSET(cpu, &allowed)))
+          list.push_back(cpu);
+      }
+      if (!list.empty()) // memory-only nodes still get pages but no threads
+        node_cpus.push_back(list);
+      mem_nodes[node / BITS] |= 1ul << (node % BITS);
+    }
+    if (node_cpus.empty()) { // no NUMA information (e.g. inside some containers), treat as a single node
+      node_cpus.push_back({});
+      for (int cpu = 0; cpu < sysconf(_SC_NPROCESSORS_ONLN); cpu++) {
+        if (!known || (cpu < CPU_SETSIZE && CPU_ISSET(cpu, &allowed)))
+          node_cpus[0].push_back(cpu);
+      }
+      mem_nodes[0] = 1;
+    }
+
+    // Consecutive slots alternate between the nodes so that the threads of every engine use all of them equally
+    for (size_t i = 0; cpus.size() < n_cpus(); i++) {
+      for (auto& list : node_cpus) {
+        if (i < list.size())
+          cpus.push_back(list[i]);
+      }
+    }
+
+    if (policy1 == AUTO)
+      policy1 = node_cpus.size() > 1 ? INTERLEAVE : PIN;
+
+    // Pinning may be forbidden altogether (e.g. by a seccomp profile), check once on the main thread and restore
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    CPU_SET(cpus.empty() ? 0 : cpus[0], &set);
+    if (cpus.empty() || !known || sched_setaffinity(0, sizeof(set), &set) != 0)
+      return policy = NONE;
+    sched_setaffinity(0, sizeof(allowed), &allowed);
+    policy = policy1;
+    return policy;
+  }
+
+  int n_nodes() {
+    return node_cpus.size();
+  }
+
+  int reserve(int n) {
+    if (policy < PIN)
+      return -1;
+    return next_slot.fetch_add(n);
+  }
+
+  void pin(int slot) {
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    CPU_SET(cpus[slot % cpus.size()], &set);
+    // 0 is the calling thread; report only once, the thread simply keeps floating
+    if (sched_setaffinity(0, sizeof(set), &set) != 0 && !pin_failed.exchange(true))
+      std::cerr << "Warning: Could not pin a search thread to CPU " << cpus[slot % cpus.size()] << "." << std::endl;
+  }
+
+  bool interleave(void *data, size_t size) {
+    if (policy < INTERLEAVE || !data)
+      return false;
+
+    // Only whole pages can be placed; the at most two partial ones at the ends do not matter
+    size_t page = sysconf(_SC_PAGESIZE);
+    size_t start = ((size_t) data + page - 1) & ~(page - 1);
+    size_t end = ((size_t) data + size) & ~(page - 1);
+    if (start >= end)
+      return false;
+
+    // The kernel expects one more than the number of bits in the mask; already loaded pages are migrated
+    return syscall(SYS_mbind, start, end - start, MPOL_INTERLEAVE, mem_nodes, MAX_NODES + 1, MPOL_MF_MOVE) != 0;
+  }
+
+}
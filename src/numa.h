@@ -0,0 +1,40 @@
+/**
+ * Optional NUMA-awareness for multi-socket machines: pinning of the search threads to individual CPUs and spreading
+ * the large tables over the memory of all nodes. Without it, threads float freely and every table lives on the node
+ * of the thread that loaded it, i.e. most lookups from the other sockets cross the interconnect. The topology is read
+ * from `/sys/devices/system/node`; no `libnuma` is needed.
+ */
+
+#ifndef __NUMA__
+#define __NUMA__
+
+#include <cstddef>
+#include <string>
+
+namespace numa {
+
+  // Placement policies
+  const int NONE = 0;
+  const int PIN = 1; // pin every search thread to its own CPU, spreading the threads of each engine over all nodes
+  const int INTERLEAVE = 2; // additionally interleave the table pages over all nodes
+  const int AUTO = 3; // `PIN` on a single node and `INTERLEAVE` on several
+
+  int parse(const std::string& s); // policy by name ("pin", "interleave", "auto"); -1 if invalid
+
+  // Detect the topology (limited to the CPUs the process may run on) and select the policy; returns the effective one,
+  // i.e. `NONE` if threads cannot be pinned at all
+  int init(int policy);
+  int n_nodes();
+
+  // First of `n` consecutive CPU slots for the threads of an engine (so that engines do not pin to the same CPUs); -1
+  // if threads are not pinned
+  int reserve(int n);
+  void pin(int slot); // pin the calling thread to the CPU of `slot`; a failure is reported once on stderr
+
+  // Spread the pages of `data` over all nodes if interleaving is enabled; true if this failed (e.g. `mbind()` is not
+  // permitted in a container)
+  bool interleave(void *data, size_t size);
+
+}
+
+#endif
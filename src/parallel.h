@@ -0,0 +1,40 @@
+/**
+ * Simple utilities for spreading table generation over all available cores.
+ */
+
+#ifndef __PARALLEL__
+#define __PARALLEL__
+
+#include <algorithm>
+#include <atomic>
+#include <thread>
+#include <vector>
+
+namespace parallel {
+
+  inline int n_threads() {
+    return std::max(int(std::thread::hardware_concurrency()), 1); // 0 if unknown
+  }
+
+  // Calls `f(start, end)` for consecutive blocks of [0, `n`) from all cores; blocks are handed out in increasing order
+  // s.t. all threads progress through the range roughly together
+  template <typename F>
+  void blocks(int n, int block, F f) {
+    std::atomic<int> next(0);
+    auto work = [&]() {
+      int start;
+      while ((start = next.fetch_add(block)) < n)
+        f(start, std::min(start + block, n));
+    };
+
+    std::vector<std::thread> threads;
+    for (int i = 1; i < n_threads(); i++)
+      threads.push_back(std::thread(work));
+    work(); // the calling thread helps as well
+    for (std::thread& t : threads)
+      t.join();
+  }
+
+}
+
+#endif
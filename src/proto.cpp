@@ -0,0 +1,123 @@
+#include "proto.h"
+
+#include <chrono>
+#include <cstring>
+#include <string>
+#include <unistd.h>
+
+#include "face.h"
+
+namespace proto {
+
+  const char FACES[] = "UDRLFB";
+
+  bool read_full(int fd, void *buf, int size) {
+    char *p = (char *) buf;
+    while (size > 0) {
+      int n = read(fd, p, size);
+      if (n <= 0)
+        return false;
+      p += n;
+      size -= n;
+    }
+    return true;
+  }
+
+  bool write_full(int fd, const void *buf, int size) {
+    const char *p = (const char *) buf;
+    while (size > 0) {
+      int n = write(fd, p, size);
+      if (n <= 0)
+        return false;
+      p += n;
+      size -= n;
+    }
+    return true;
+  }
+
+  move::mask faces(uint8_t bits) {
+    std::string s;
+    for (int f = 0; f < 6; f++) {
+      if (bits & (1 << f))
+        s += FACES[f];
+    }
+    return move::faces(s);
+  }
+
+  int decode(const request& req, cubie::cube& c, move::mask& first, move::mask& last) {
+    if (req.format == FACELETS) {
+      if (face::to_cubie(std::string((const char *) req.cube, face::N_FACELETS), c) != 0)
+        return EFACE;
+    } else if (req.format == CUBIE) {
+      const uint8_t *p = req.cube;
+      for (int i = 0; i < cubie::corner::COUNT; i++)
+        c.cperm[i] = *p++;
+      for (int i = 0; i < cubie::corner::COUNT; i++)
+        c.cori[i] = *p++;
+      for (int i = 0; i < cubie::edge::COUNT; i++)
+        c.eperm[i] = *p++;
+      for (int i = 0; i < cubie::edge::COUNT; i++)
+        c.eori[i] = *p++;
+    } else
+      return EFORMAT;
+    if (cubie::check(c) != 0)
+      return ECUBIE;
+
+    if (req.first)
+      first = faces(req.first);
+    if (req.last)
+      last = faces(req.last);
+    if (first == 0 || last == 0)
+      return EFACES;
+    return OK;
+  }
+
+  void encode(uint32_t id, int status, uint32_t time, const std::vector<std::vector<int>>& sols, std::vector<uint8_t>& out) {
+    out.resize(sizeof(response));
+    for (auto& sol : sols) {
+      out.push_back(sol.size());
+      for (int m : sol)
+        out.push_back(m);
+    }
+
+    response res;
+    res.id = id;
+    res.status = status;
+    res.time = time;
+    res.n_sols = sols.size();
+    res.size = out.size() - sizeof(response);
+    memcpy(out.data(), &res, sizeof(res));
+  }
+
+  void serve(solve::Engine& solver, int in, int out, move::mask first, move::mask last) {
+    request req;
+    std::vector<std::vector<int>> sols;
+    std::vector<uint8_t> buf;
+
+    while (true) {
+      solver.prepare(); // have the threads ready before the next request arrives
+      if (!read_full(in, &req, sizeof(req)))
+        break;
+
+      cubie::cube c;
+      move::mask first1 = first;
+      move::mask last1 = last;
+      int status = decode(req, c, first1, last1);
+      sols.clear();
+      uint32_t time = 0;
+      if (status == OK) {
+        solver.limits(req.tlim, req.n_sols, req.max_len);
+        auto tick = std::chrono::high_resolution_clock::now();
+        solver.solve(c, sols, first1, last1);
+        time = std::chrono::duration_cast<std::chrono::microseconds>(
+          std::chrono::high_resolution_clock::now() - tick
+        ).count();
+      }
+
+      encode(req.id, status, time, sols, buf);
+      if (!write_full(out, buf.data(), buf.size()))
+        break;
+    }
+  }
+
+}
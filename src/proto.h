@@ -0,0 +1,69 @@
+/**
+ * Compact binary request/response protocol as an alternative to the interactive text mode. Every request is a fixed
+ * 72 byte record and every response a 16 byte header followed by the solutions as plain move indices. All integers are
+ * in native byte order (i.e. client and solver are expected to run on the same machine).
+ */
+
+#ifndef __PROTO__
+#define __PROTO__
+
+#include <cstdint>
+#include <vector>
+
+#include "cubie.h"
+#include "move.h"
+#include "solve.h"
+
+namespace proto {
+
+  // Cube formats of a request
+  const int FACELETS = 0; // 54 facelet characters as for `solve` in text mode
+  const int CUBIE = 1; // 8 corner perm., 8 corner ori., 12 edge perm., 12 edge ori. bytes (see `cubie::cube`)
+
+  // Response status codes
+  const int OK = 0;
+  const int EFORMAT = -1; // unknown cube format
+  const int EFACE = -2; // invalid facelet string
+  const int ECUBIE = -3; // unsolvable cube
+  const int EFACES = -4; // restricted to faces without any moves (i.e. only B with `-DF5`)
+
+  struct request {
+    uint32_t id; // returned unchanged in the response
+    uint8_t format;
+    uint8_t first; // bit `i` permits first moves turning face `i` in order UDRLFB (like `-f`); 0 for the default
+    uint8_t last; // same for the last move (like `-e`)
+    uint8_t priority; // requests with higher priority are solved first when queued (daemon mode)
+    // Per request `-m`, `-l` and `-n`; 0 selects the solver's value
+    uint16_t tlim;
+    int8_t max_len;
+    uint8_t n_sols;
+    uint32_t reserved;
+    uint8_t cube[56];
+  };
+
+  struct response {
+    uint32_t id;
+    int32_t status;
+    uint32_t time; // solving time in microseconds
+    uint16_t n_sols;
+    uint16_t size; // number of bytes following; every solution is its length followed by that many move indices
+  };
+
+  static_assert(sizeof(request) == 72, "request records must be 72 bytes");
+  static_assert(sizeof(response) == 16, "response headers must be 16 bytes");
+
+  // Read or write exactly `size` bytes; return false on EOF or error
+  bool read_full(int fd, void *buf, int size);
+  bool write_full(int fd, const void *buf, int size);
+
+  // Decode the cube and move restrictions of `req` (`first` and `last` are kept if not given); returns a status code
+  int decode(const request& req, cubie::cube& c, move::mask& first, move::mask& last);
+  // Encode the full response (header + solutions) for request `id`
+  void encode(uint32_t id, int status, uint32_t time, const std::vector<std::vector<int>>& sols, std::vector<uint8_t>& out);
+
+  // Answer requests from `in` on `out` until `in` is closed; `first` and `last` are the default move restrictions
+  void serve(solve::Engine& solver, int in, int out, move::mask first, move::mask last);
+
+}
+
+#endif
@@ -1,11 +1,20 @@
 #include "prun.h"
 
+#include <atomic>
 #include <bitset>
+#include <chrono>
+#include <functional>
 #include <iostream>
+#include <limits>
 #include <cstring>
+#include <vector>
+
+#include "huff.h"
+#include "numa.h"
+#include "parallel.h"
 
 namespace prun {
-  const std::string SAVE = "twophase-"
+  const std::string NAME = "twophase-"
     #ifdef AX
       "ax"
     #endif
@@ -17,16 +26,20 @@ namespace prun {
     #ifdef F5
       "-f5"
     #endif
-    ".tbl"
   ;
+  const std::string SAVE = NAME + ".tbl";
+  const std::string SAVE_PHASE2X = NAME + "-p2x.tbl";
+  const std::string SAVE_PHASE2NEXT = NAME + "-p2n.tbl";
+  const std::string SAVE_LOW = NAME + "-low.tbl";
+  const std::string PART = SAVE + ".part"; // the table file while it is being generated
+  const std::string CHECKPOINT = SAVE + ".ckpt";
+  const std::string SAVE_Z = SAVE + ".z"; // compressed version of `SAVE`
+  const int Z_BLOCK = 1 << 20; // raw bytes per independently compressed block
+  const int CHECKPOINT_SECS = 10; // minimum time between two checkpoints during a BFS
 
   const int EMPTY = 0xff;
+  const int VERSION = 4; // stored at the start of the table file; bump whenever the table layout changes
 
-  #ifdef AX
-    const int BITS_PER_AX = 16; // bits used for encoding an axis in the ext. phase 1 table
-  #else
-    const int BITS_PER_AX = 8;
-  #endif
   #ifdef QT
     const int BITS_PER_M = 2; // bits per move
     const int N_SIMP = 4; // number of simple moves
@@ -37,14 +50,39 @@ namespace prun {
     const int N_AX = 9;
   #endif
 
-  // Used to remap symmetry ext. phase 1 table entries back to actual situation
-  move::mask remap[2][16][1 << BITS_PER_AX];
+  #ifdef AX
+    uint16_t perm_ax[4][2][256];
+    uint8_t unzip_tbl[256];
+  #else
+    move::mask remap[2][16][1 << BITS_PER_AX];
+  #endif
+  uint32_t remap2[sym::COUNT_SUB][N_CHUNKS2][256];
+  #if defined(QT) && !defined(AX)
+    move::mask quarter2;
+  #endif
 
   prun1 *phase1;
+  uint8_t *phase1_dist;
   uint8_t *phase2;
+  prun2 *phase2_next = nullptr;
+  uint8_t *phase2_dist;
   uint8_t *precheck;
+  uint8_t *phase2x = nullptr;
+  uint8_t *phase2raw = nullptr;
+  std::atomic<bool> ready(true);
+  uint8_t *weak_fs1;
+  uint8_t *weak_ts1;
+  uint8_t *weak_cs2;
+  uint8_t *weak_us2;
+
 
-  inline int ones(int count) { return (1 << count) - 1; }
+  using clock = std::chrono::steady_clock;
+
+  // Reports `count` out of `total` entries done together with the time since `tick`
+  void progress(const std::string& step, int64_t count, int64_t total, clock::time_point tick) {
+    std::cout << step << ": " << count << " / " << total << " (" << 100 * count / total << "%), "
+      << std::chrono::duration_cast<std::chrono::milliseconds>(clock::now() - tick).count() / 1000. << "s" << std::endl;
+  }
 
   int rev(int movec, int count, int off = 0, int step = BITS_PER_M) {
     movec >>= step * off;
@@ -112,19 +150,53 @@ namespace prun {
       #endif
     #endif
 
-    for (int eff = 0; eff < 16; eff++) {
-      for (int mask = 0; mask < (1 << BITS_PER_AX); mask++) {
-        move::mask mask1 = mask;
-        #ifndef QT
-          mask1 >>= 1; // first bit encodes direction in HT
-        #endif
+    #ifdef AX
+      for (int b = 0; b < 256; b++) {
+        unzip_tbl[b] = 0;
+        for (int i = 0; i < 4; i++)
+          unzip_tbl[b] |= ((b >> 2 * i) & 1) << i | ((b >> (2 * i + 1)) & 1) << (4 + i);
+      }
 
-        if (sym::eff_inv(eff))
-          mask1 = inv(mask1);
-        if (sym::eff_flip(eff))
-          mask1 = flip(mask1);
+      // Both symmetry operations only permute the moves of an axis, hence we can simply apply them to single bytes
+      for (int p = 0; p < 4; p++) {
+        for (int half = 0; half < 2; half++) {
+          for (int b = 0; b < 256; b++) {
+            int mask = b << 8 * half;
+            #ifdef QT
+              if (half == 1)
+                break; // only 8 moves per axis
+              int mask1 = 0;
+              for (int i = 0; i < BITS_PER_AX / 2; i++) // operations work on 2-bit move codes
+                mask1 |= ((mask >> i) & 1) << 2 * i;
+              mask = mask1;
+            #else
+              mask &= ones(BITS_PER_AX - 1);
+            #endif
+
+            if (sym::eff_inv(p))
+              mask = inv(mask);
+            if (sym::eff_flip(p))
+              mask = flip(mask);
+
+            #ifdef QT
+              mask1 = 0;
+              for (int i = 0; i < BITS_PER_AX / 2; i++)
+                mask1 |= ((mask >> 2 * i) & 1) << i;
+              mask = mask1;
+            #endif
+            perm_ax[p][half][b] = mask;
+          }
+        }
+      }
+    #else
+      for (int eff = 0; eff < 16; eff++) {
+        for (int mask = 0; mask < (1 << BITS_PER_AX); mask++) {
+          move::mask mask1 = mask;
+          if (sym::eff_inv(eff))
+            mask1 = inv(mask1);
+          if (sym::eff_flip(eff))
+            mask1 = flip(mask1);
 
-        #ifdef QT
           remap[0][eff][mask] = 0;
           remap[1][eff][mask] = 0;
           for (int i = 0; i < BITS_PER_AX / 2; i++) {
@@ -134,24 +206,86 @@ namespace prun {
           }
           remap[0][eff][mask] <<= (BITS_PER_AX / 2) * sym::eff_shift(eff);
           remap[1][eff][mask] <<= (BITS_PER_AX / 2) * sym::eff_shift(eff);
-        #else
-          move::mask o = ones(BITS_PER_AX - 1); // first bit indicates direction but is not a move
-          remap[0][eff][mask] = ((mask & 1) ? 0 : ~mask1 & o) << (BITS_PER_AX - 1) * sym::eff_shift(eff);
-          remap[1][eff][mask] = ((mask & 1) ? ~mask1 & o : o) << (BITS_PER_AX - 1) * sym::eff_shift(eff);
-        #endif
+        }
+      }
+    #endif
+  }
+
+  void init_remap2() {
+    // Move `m` of a position corresponds to `sym::conj_move[m][s]` of its class representative
+    int p2index[move::COUNT];
+    for (int m = 0; m < move::COUNT_P2; m++)
+      p2index[move::p2moves[m]] = m;
+    for (int s = 0; s < sym::COUNT_SUB; s++) {
+      for (int i = 0; i < N_CHUNKS2; i++) {
+        for (int mask = 0; mask < 256; mask++) {
+          remap2[s][i][mask] = 0;
+          for (int m = 0; m < move::COUNT_P2; m++) {
+            int m1 = p2index[sym::conj_move[move::p2moves[m]][s]] - 8 * i;
+            if (0 <= m1 && m1 < 8 && (mask & (1 << m1)))
+              remap2[s][i][mask] |= 1 << m;
+          }
+        }
       }
     }
+    #if defined(QT) && !defined(AX)
+      quarter2 = 0;
+      for (int m = 0; m < move::COUNT_P2; m++) {
+        if (move::p2moves[m] < move::COUNT1)
+          quarter2 |= move::bit(m);
+      }
+    #endif
+  }
+
+  // Encodes the distance changes `deltas` of all phase 1 moves into a phase 1 table entry
+  prun1 encode1(const int deltas[]) {
+    prun1 prun = 0;
+    #ifdef QT
+      // In QT there is enough space to simply encode the effect of every move in 2 bits
+      for (int m = std::bitset<64>(move::p1mask).count() - 1; m >= 0; m--)
+          prun = (prun << 2) | (deltas[m] + 1);
+    #else
+      #ifndef AX
+        int n_ax = 6; // in standard (HT) mode we have to treat every face as an individual axis for encoding
+        int bits_per_ax = 4;
+      #else
+        int n_ax = 3;
+        int bits_per_ax = BITS_PER_AX;
+      #endif
+        /* Encode from left to right to preserve indexing of moves */
+        for (int ax = n_ax - 1; ax >= 0; ax--) {
+          bool away = false; // first bit of axis encoding (whether any move brings us further from the goal)
+          for (int i = ax * (bits_per_ax - 1); i < (ax + 1) * (bits_per_ax - 1); i++) {
+            if (deltas[i] != 0) {
+              if (deltas[i] > 0)
+                away = true;
+              break; // stop immediately once we found a value != 0
+            }
+          }
+
+          int tmp = 0;
+          for (int i = (ax + 1) * (bits_per_ax - 1) - 1; i >= ax * (bits_per_ax - 1); i--)
+            tmp = (tmp | (away ? deltas[i] : deltas[i] + 1)) << 1;
+          tmp |= away;
+
+          prun = (prun << bits_per_ax) | tmp;
+        }
+    #endif
+    return prun;
   }
 
-  void init_phase1() {
+  // Without `masks`, only the mod 3 distances are generated
+  void init_phase1(bool masks) {
     int n_moves = std::bitset<64>(move::p1mask).count(); // make sure not to consider B-moves in F5-mode
 
-    phase1 = new prun1[N_FS1TWIST];
-    std::fill(phase1, phase1 + N_FS1TWIST, EMPTY);
+    phase1 = masks ? new prun1[N_FS1TWIST] : nullptr;
+    uint8_t *dists = new uint8_t[N_FS1TWIST]; // full distances are only needed during generation
+    std::fill(dists, dists + N_FS1TWIST, EMPTY);
 
-    phase1[coord::N_TWIST * sym::coord_c(sym::fslice1_sym[coord::fslice1(0, coord::SLICE1_SOLVED)])] = 0;
+    dists[coord::N_TWIST * sym::coord_c(sym::fslice1_sym[coord::fslice1(0, coord::SLICE1_SOLVED)])] = 0;
     int count = 0;
     int dist = 0;
+    clock::time_point tick = clock::now();
 
     while (count < N_FS1TWIST) {
       int coord = 0;
@@ -162,9 +296,9 @@ namespace prun {
         int slice = coord::slice1_to_slice(coord::fslice1_to_slice1(fslice1));
 
         for (int twist = 0; twist < coord::N_TWIST; twist++) {
-          if ((phase1[coord] & 0xff) == dist) {
+          if (dists[coord] == dist) {
             count++;
-            int deltas[move::COUNT1]; // easier encoding if B-face always exists (F5-mode ignores it anyways)
+            int deltas[move::COUNT1] = {}; // easier encoding if B-face always exists (F5-mode ignores it anyways)
 
             for (int m = 0; m < n_moves; m++) {
               int slice11 = coord::slice_to_slice1(coord::move_edges4[slice][m]);
@@ -174,72 +308,52 @@ namespace prun {
               int fs1sym1 = sym::coord_c(tmp);
               int coord1 = coord::N_TWIST * fs1sym1 + twist1;
 
-              if (phase1[coord1] == EMPTY)
-                phase1[coord1] = dist + 1;
-              deltas[m] = (phase1[coord1] & 0xff) - dist;
+              if (dists[coord1] == EMPTY)
+                dists[coord1] = dist + 1;
+              deltas[m] = dists[coord1] - dist;
               coord1 -= twist1; // only TWIST part changes below
 
               int selfs = sym::fslice1_selfs[fs1sym1] >> 1;
               for (int s = 1; selfs > 0; s++) { // bit 0 is always on
                 if (selfs & 1) {
                   int coord2 = coord1 + sym::conj_twist[twist1][s];
-                  if (phase1[coord2] == EMPTY)
-                    phase1[coord2] = dist + 1;
+                  if (dists[coord2] == EMPTY)
+                    dists[coord2] = dist + 1;
                 }
                 selfs >>= 1;
               }
             }
 
-            prun1 prun = 0;
-            #ifdef QT
-              // In QT there is enough space to simply encode the effect of every move in 2 bits
-              for (int m = n_moves - 1; m >= 0; m--)
-                  prun = (prun << 2) | (deltas[m] + 1);
-            #else
-              #ifndef AX
-                int n_ax = 6; // in standard (HT) mode we have to treat every face as an individual axis for encoding
-                int bits_per_ax = 4;
-              #else
-                int n_ax = 3;
-                int bits_per_ax = BITS_PER_AX;
-              #endif
-                /* Encode from left to right to preserve indexing of moves */
-                for (int ax = n_ax - 1; ax >= 0; ax--) {
-                  bool away = false; // first bit of axis encoding (whether any move brings us further from the goal)
-                  for (int i = ax * (bits_per_ax - 1); i < (ax + 1) * (bits_per_ax - 1); i++) {
-                    if (deltas[i] != 0) {
-                      if (deltas[i] > 0)
-                        away = true;
-                      break; // stop immediately once we found a value != 0
-                    }
-                  }
-
-                  int tmp = 0;
-                  for (int i = (ax + 1) * (bits_per_ax - 1) - 1; i >= ax * (bits_per_ax - 1); i--)
-                    tmp = (tmp | (away ? deltas[i] : deltas[i] + 1)) << 1;
-                  tmp |= away;
-
-                  prun = (prun << bits_per_ax) | tmp;
-                }
-            #endif
-            phase1[coord] |= prun << 8;
+            if (phase1)
+              phase1[coord] = encode1(deltas);
           }
           coord++;
         }
       }
 
-      std::cout << dist << " " << count << std::endl;
+      progress("phase 1 depth " + std::to_string(dist), count, N_FS1TWIST, tick);
       dist++;
     }
+
+    phase1_dist = new uint8_t[N_PHASE1_DIST];
+    std::fill(phase1_dist, phase1_dist + N_PHASE1_DIST, 0);
+    for (int coord = 0; coord < N_FS1TWIST; coord++)
+      phase1_dist[coord >> 2] |= (dists[coord] % 3) << 2 * (coord & 3);
+    delete[] dists;
   }
 
-  void init_phase2() {
-    phase2 = new uint8_t[N_CORNUD2];
-    std::fill(phase2, phase2 + N_CORNUD2, EMPTY);
+  // Phase 2 distances with only the solved entry filled
+  uint8_t *start_phase2() {
+    uint8_t *dists = new uint8_t[N_CORNUD2];
+    std::fill(dists, dists + N_CORNUD2, EMPTY);
+    dists[0] = 0;
+    return dists;
+  }
 
-    phase2[0] = 0;
-    int count = 0;
-    int dist = 0;
+  // Continues the phase 2 BFS in `dists` from layer `dist` where `count` entries have a smaller distance; calls
+  // `step(dist, count)` after every finished layer (with the values to continue from)
+  void bfs_phase2(uint8_t *dists, int dist, int count, const std::function<void(int, int)>& step = nullptr) {
+    clock::time_point tick = clock::now();
 
     while (count < N_CORNUD2) {
       int coord = 0;
@@ -248,36 +362,34 @@ namespace prun {
         int corners = sym::corners_raw[csym];
 
         for (int udedges2 = 0; udedges2 < coord::N_UDEDGES2; udedges2++) {
-          if (phase2[coord] == dist) {
+          if (dists[coord] == dist) {
             count++;
 
-            for (move::mask moves = move::p2mask; moves; moves &= moves - 1) {
-              int m = ffsll(moves) - 1;
-
+            for (int m = 0; m < move::COUNT_P2; m++) {
               int dist1 = dist + 1;
               #ifdef QT
-                if (m >= move::COUNT1)
+                if (move::p2moves[m] >= move::COUNT1)
                   dist1++; // half-turns cost 2 in QTM
               #endif
 
-              int corners1 = coord::move_corners[corners][m];
+              int corners1 = coord::move_corners2[corners][m];
               int udedges21 = coord::move_udedges2[udedges2][m];
               int tmp = sym::corners_sym[corners1];
               udedges21 = sym::conj_udedges2[udedges21][sym::coord_s(tmp)];
               int csym1 = sym::coord_c(tmp);
               int coord1 = coord::N_UDEDGES2 * csym1 + udedges21;
 
-              if (phase2[coord1] <= dist1)
+              if (dists[coord1] <= dist1)
                 continue;
-              phase2[coord1] = dist1;
+              dists[coord1] = dist1;
               coord1 -= udedges21;
 
               int selfs = sym::corners_selfs[csym1] >> 1;
               for (int s = 1; selfs > 0; s++) {
                 if (selfs & 1) {
                   int coord2 = coord1 + sym::conj_udedges2[udedges21][s];
-                  if (phase2[coord2] > dist1)
-                    phase2[coord2] = dist1;
+                  if (dists[coord2] > dist1)
+                    dists[coord2] = dist1;
                 }
                 selfs >>= 1;
               }
@@ -287,9 +399,56 @@ namespace prun {
         }
       }
 
-      std::cout << dist << " " << count << std::endl;
+      progress("phase 2 depth " + std::to_string(dist), count, N_CORNUD2, tick);
       dist++;
+      if (step)
+        step(dist, count);
+    }
+
+  }
+
+  // Move-masks of all classes in [`start`, `end`) into `entries` (starting with class `start`)
+  void fill_phase2_next(const uint8_t *dists, prun2 *entries, int start, int end) {
+    for (int csym = start; csym < end; csym++) {
+      int corners = sym::corners_raw[csym];
+
+      for (int udedges2 = 0; udedges2 < coord::N_UDEDGES2; udedges2++) {
+        int coord = coord::N_UDEDGES2 * csym + udedges2;
+        prun2 dec = 0;
+        prun2 same = 0;
+
+        for (int m = 0; m < move::COUNT_P2; m++) {
+          int corners1 = coord::move_corners2[corners][m];
+          int udedges21 = coord::move_udedges2[udedges2][m];
+          int tmp = sym::corners_sym[corners1];
+          int dist1 = dists[
+            coord::N_UDEDGES2 * sym::coord_c(tmp) + sym::conj_udedges2[udedges21][sym::coord_s(tmp)]
+          ];
+          if (dist1 < dists[coord])
+            dec |= prun2(1) << m;
+          else if (dist1 == dists[coord])
+            same |= prun2(1) << m;
+        }
+
+        entries[coord - coord::N_UDEDGES2 * start] = dec | same << move::COUNT_P2;
+      }
+    }
+  }
+
+  // With `lowmem`, only the 4-bit distances are kept
+  void init_phase2(bool lowmem) {
+    uint8_t *dists = start_phase2();
+    bfs_phase2(dists, 0, 0);
+
+    if (!lowmem) {
+      phase2 = dists;
+      return;
     }
+    phase2 = nullptr;
+    phase2_dist = new uint8_t[N_PHASE2_DIST];
+    for (int coord = 0; coord < N_CORNUD2; coord += 2)
+      phase2_dist[coord >> 1] = std::min(int(dists[coord]), 15) | std::min(int(dists[coord + 1]), 15) << 4;
+    delete[] dists;
   }
 
   void init_precheck() {
@@ -299,6 +458,7 @@ namespace prun {
     precheck[0] = 0;
     int dist = 0;
     int count = 0;
+    clock::time_point tick = clock::now();
 
     while (count < N_CSLICE2) {
       int coord = 0;
@@ -307,19 +467,16 @@ namespace prun {
         for (int slice2 = 0; slice2 < coord::N_SLICE2; slice2++) {
           if (precheck[coord] == dist) {
             count++;
-            int slice = coord::slice2_to_slice(slice2);
-
-            for (move::mask moves = move::p2mask; moves; moves &= moves - 1) {
-              int m = ffsll(moves) - 1;
 
+            for (int m = 0; m < move::COUNT_P2; m++) {
               int dist1 = dist + 1;
               #ifdef QT
-                if (m >= move::COUNT1)
+                if (move::p2moves[m] >= move::COUNT1)
                   dist1++; // half-turns cost 2 in QTM
               #endif
 
-              int corners1 = coord::move_corners[corners][m];
-              int slice21 = coord::slice_to_slice2(coord::move_edges4[slice][m]);
+              int corners1 = coord::move_corners2[corners][m];
+              int slice21 = coord::move_slice2[slice2][m];
 
               int coord1 = coord::N_SLICE2 * corners1 + slice21;
               if (precheck[coord1] > dist1)
@@ -330,36 +487,207 @@ namespace prun {
         }
       }
 
-      std::cout << dist << " " << count << std::endl;
+      progress("precheck depth " + std::to_string(dist), count, N_CSLICE2, tick);
       dist++;
     }
   }
 
-  int get_phase1(int flip, int slice, int twist, int togo, move::mask& next) {
-    int tmp = sym::fslice1_sym[coord::fslice1(flip, coord::slice_to_slice1(slice))];
-    int s = sym::coord_s(tmp);
-    prun1 prun = phase1[coord::N_TWIST * sym::coord_c(tmp) + sym::conj_twist[twist][s]];
-
-    int dist = prun & 0xff;
-    int delta = togo - dist;
-
-    // `delta` < 0 case can never happen during a real search
-    if (delta > 1)
-      next = move::p1mask; // all moves are possible
-    else {
-      prun >>= 8; // get rid of dist
-      next = 0;
-      for (int ax = 0; ax < 3; ax++) {
-        next |= remap[delta][sym::effect[s][ax]][prun & ones(BITS_PER_AX)];
-        prun >>= BITS_PER_AX;
+  // Phase 2 may contain half-turns of cost 2 in QT mode
+  int cost2(int m) {
+    #ifdef QT
+      if (move::p2moves[m] >= move::COUNT1)
+        return 2;
+    #else
+      (void) m;
+    #endif
+    return 1;
+  }
+
+  /* Simple BFS over `n` coordinates from `solved` where `neighbour(coord, m)` gives the coordinate reached by move `m`;
+   * uses phase 2 move costs if `phase2` is set */
+  template <typename F>
+  uint8_t *bfs_small(int n, int solved, bool phase2, F neighbour) {
+    int n_moves = phase2 ? move::COUNT_P2 : std::bitset<64>(move::p1mask).count();
+    uint8_t *dists = new uint8_t[n];
+    std::fill(dists, dists + n, EMPTY);
+    dists[solved] = 0;
+
+    int max_dist = 0; // largest distance assigned so far
+    for (int dist = 0; dist <= max_dist; dist++) {
+      for (int coord = 0; coord < n; coord++) {
+        if (dists[coord] != dist)
+          continue;
+        for (int m = 0; m < n_moves; m++) {
+          int coord1 = neighbour(coord, m);
+          int dist1 = dist + (phase2 ? cost2(m) : 1);
+          if (dists[coord1] > dist1) {
+            dists[coord1] = dist1;
+            max_dist = std::max(max_dist, dist1);
+          }
+        }
       }
     }
+    return dists;
+  }
+
+  void init_weak() {
+    ready = false;
+
+    int n_fs1 = coord::N_FLIP * coord::N_SLICE1;
+    weak_fs1 = bfs_small(n_fs1, coord::N_FLIP * coord::SLICE1_SOLVED, false, [](int coord, int m) {
+      int flip = coord % coord::N_FLIP;
+      int slice1 = coord::slice_to_slice1(coord::move_edges4[coord::slice1_to_slice(coord / coord::N_FLIP)][m]);
+      return coord::N_FLIP * slice1 + coord::move_flip[flip][m];
+    });
+    int n_ts1 = coord::N_TWIST * coord::N_SLICE1;
+    weak_ts1 = bfs_small(n_ts1, coord::N_TWIST * coord::SLICE1_SOLVED, false, [](int coord, int m) {
+      int twist = coord % coord::N_TWIST;
+      int slice1 = coord::slice_to_slice1(coord::move_edges4[coord::slice1_to_slice(coord / coord::N_TWIST)][m]);
+      return coord::N_TWIST * slice1 + coord::move_twist[twist][m];
+    });
+    weak_cs2 = bfs_small(coord::N_CORNERS * coord::N_SLICE2, 0, true, [](int coord, int m) {
+      int slice2 = coord::move_slice2[coord % coord::N_SLICE2][m];
+      return coord::N_SLICE2 * coord::move_corners2[coord / coord::N_SLICE2][m] + slice2;
+    });
+    weak_us2 = bfs_small(coord::N_UDEDGES2 * coord::N_SLICE2, 0, true, [](int coord, int m) {
+      int slice2 = coord::move_slice2[coord % coord::N_SLICE2][m];
+      return coord::N_SLICE2 * coord::move_udedges2[coord / coord::N_SLICE2][m] + slice2;
+    });
+  }
+
+  inline int get_2x(int64_t coord) { return phase2x[coord >> 2] >> 2 * (coord & 3) & 0x3; }
+  inline void set_2x(int64_t coord, int dist) { phase2x[coord >> 2] &= ~((~dist & 0x3) << 2 * (coord & 3)); }
+
+  /* With >1G entries, a pure forward BFS is very slow towards the end, where it has to expand huge layers (and
+   * also re-expand all older ones with the same distance mod 3). Once half of the table is filled, we hence search
+   * backwards from all still empty entries instead. */
+  void fill_phase2x() {
+    phase2x = new uint8_t[N_PHASE2X / 4];
+    std::fill(phase2x, phase2x + N_PHASE2X / 4, EMPTY); // 3 marks an unreached entry
+
+    // SLICE2 parity is implied by the ones of CORNERS and UDEDGES2 (the ones of the other edges never change)
+    bool *corners_par = new bool[sym::N_CORNERS];
+    bool *udedges2_par = new bool[coord::N_UDEDGES2];
+    cubie::cube c = cubie::SOLVED_CUBE;
+    for (int csym = 0; csym < sym::N_CORNERS; csym++) {
+      coord::set_corners(c, sym::corners_raw[csym]);
+      corners_par[csym] = cubie::parity(c.cperm, cubie::corner::COUNT);
+    }
+    for (int udedges2 = 0; udedges2 < coord::N_UDEDGES2; udedges2++) {
+      coord::set_udedges2(c, udedges2);
+      udedges2_par[udedges2] = cubie::parity(c.eperm, cubie::edge::COUNT);
+    }
+
+    set_2x(0, 0);
+    int64_t count = 1;
+    int dist = 0;
+    clock::time_point tick = clock::now();
+
+    while (count < N_PHASE2X) {
+      bool backward = count > N_PHASE2X / 2;
+      int64_t coord = 0;
 
+      for (int csym = 0; csym < sym::N_CORNERS; csym++) {
+        int corners = sym::corners_raw[csym];
+
+        for (int slice2h = 0; slice2h < N_SLICE2X; slice2h++) {
+          for (int udedges2 = 0; udedges2 < coord::N_UDEDGES2; udedges2++, coord++) {
+            int val = get_2x(coord);
+            // Layer `dist` + 1 is reached by cost 1 moves from layer `dist` and by cost 2 ones from layer `dist` - 1
+            bool expand1 = val == dist % 3;
+            bool expand2 = dist > 0 && val == (dist + 2) % 3;
+            if (backward ? val != 3 : !expand1 && !expand2)
+              continue;
+
+            // Permutation ranks are lexicographic, hence 2 * `slice2h` and 2 * `slice2h` + 1 have opposite parity
+            int slice2 = 2 * slice2h + (corners_par[csym] ^ udedges2_par[udedges2] ^ (slice2h & 1));
+
+            for (int m = 0; m < move::COUNT_P2; m++) {
+              if (!backward && !(cost2(m) == 1 ? expand1 : expand2))
+                continue;
+
+              int corners1 = coord::move_corners2[corners][m];
+              int tmp = sym::corners_sym[corners1];
+              int s = sym::coord_s(tmp);
+              int slice21 = sym::conj_slice2[coord::move_slice2[slice2][m]][s];
+              int udedges21 = sym::conj_udedges2[coord::move_udedges2[udedges2][m]][s];
+              int csym1 = sym::coord_c(tmp);
+              int64_t coord1 = (int64_t(N_SLICE2X) * csym1 + (slice21 >> 1)) * coord::N_UDEDGES2 + udedges21;
+
+              if (backward) {
+                // An empty entry has distance > `dist`, thus any filled neighbour matching mod 3 is exact
+                int val1 = get_2x(coord1);
+                if (val1 != 3 && val1 == (dist + 1 - cost2(m) + 3) % 3) {
+                  set_2x(coord, (dist + 1) % 3);
+                  count++;
+                  break;
+                }
+                continue;
+              }
+
+              if (get_2x(coord1) != 3)
+                continue;
+              set_2x(coord1, (dist + 1) % 3);
+              count++;
+
+              int selfs = sym::corners_selfs[csym1] >> 1;
+              for (int s = 1; selfs > 0; s++) {
+                if (selfs & 1) {
+                  int64_t coord2 = (int64_t(N_SLICE2X) * csym1 + (sym::conj_slice2[slice21][s] >> 1)) *
+                    coord::N_UDEDGES2 + sym::conj_udedges2[udedges21][s];
+                  if (get_2x(coord2) == 3) {
+                    set_2x(coord2, (dist + 1) % 3);
+                    count++;
+                  }
+                }
+                selfs >>= 1;
+              }
+            }
+          }
+        }
+      }
+
+      progress("phase 2x depth " + std::to_string(dist), count, N_PHASE2X, tick);
+      dist++;
+    }
+
+    delete[] corners_par;
+    delete[] udedges2_par;
+  }
+
+  move::mask get_next1_dist(int fs1sym, int twist, int delta) {
+    int coord = index_phase1(fs1sym, twist);
+    int dist = (phase1_dist[coord >> 2] >> 2 * (coord & 3)) & 0x3; // only differences matter, so mod 3 suffices
+    move::mask next = 0;
+    for (move::mask mm = move::p1mask; mm; mm &= mm - 1) {
+      int m = ffsll(mm) - 1;
+      int dist1 = get_dist1(sym::move_fslice1(fs1sym, m), coord::move_twist[twist][m], dist);
+      if (dist1 < dist + delta)
+        next |= move::bit(m);
+    }
+    return next;
+  }
+
+  int get_phase1(int flip, int slice, int twist, int togo, move::mask& next) {
+    return get_phase1(sym::fslice1_sym[coord::fslice1(flip, coord::slice_to_slice1(slice))], twist, togo, next);
+  }
+
+  int get_phase1(int fs1sym, int twist, int togo, move::mask& next) {
+    // Follow distance decreasing moves until we reach the goal; takes only a single lookup per step
+    int dist = 0;
+    for (int fs1sym1 = fs1sym, twist1 = twist; move::mask next1 = get_next1(fs1sym1, twist1, 0); dist++) {
+      int m = ffsll(next1) - 1;
+      fs1sym1 = sym::move_fslice1(fs1sym1, m);
+      twist1 = coord::move_twist[twist1][m];
+    }
+    next = get_next1(fs1sym, twist, togo - dist);
     return dist;
   }
 
   int get_phase2(int corners, int udedges) {
     int tmp = sym::corners_sym[corners];
+    if (!phase2)
+      return get_phase2_dist(corners, udedges);
     return phase2[coord::N_UDEDGES2 * sym::coord_c(tmp) + sym::conj_udedges2[udedges][sym::coord_s(tmp)]];
   }
 
@@ -367,47 +695,543 @@ namespace prun {
     return precheck[coord::N_SLICE2 * corners + coord::slice_to_slice2(slice)];
   }
 
-  bool init(bool file) {
+  // Writes `size` bytes of entries with `width` bytes each as compressed blocks preceded by all their sizes
+  bool write_z(FILE *f, const void *data, int64_t size, int width) {
+    const uint8_t *bytes = (const uint8_t *) data;
+    int n = (size + Z_BLOCK - 1) / Z_BLOCK;
+    std::vector<std::vector<uint8_t>> blocks(n);
+    parallel::blocks(n, 1, [&](int start, int end) {
+      for (int i = start; i < end; i++) {
+        int64_t off = int64_t(Z_BLOCK) * i;
+        blocks[i] = huff::encode(&bytes[off], std::min(int64_t(Z_BLOCK), size - off), width);
+      }
+    });
+
+    std::vector<uint32_t> sizes(n);
+    for (int i = 0; i < n; i++)
+      sizes[i] = blocks[i].size();
+    int err = 0;
+    if (fwrite(sizes.data(), sizeof(uint32_t), n, f) != size_t(n))
+      err = 1;
+    for (std::vector<uint8_t>& block : blocks) {
+      if (fwrite(block.data(), sizeof(uint8_t), block.size(), f) != block.size())
+        err = 1;
+    }
+    return err;
+  }
+
+  // Reads a section written by `write_z()` into `data`; the whole section is read at once and then decoded in parallel
+  bool read_z(FILE *f, void *data, int64_t size, int width) {
+    uint8_t *bytes = (uint8_t *) data;
+    int n = (size + Z_BLOCK - 1) / Z_BLOCK;
+    std::vector<uint32_t> sizes(n);
+    if (fread(sizes.data(), sizeof(uint32_t), n, f) != size_t(n))
+      return true;
+    std::vector<int64_t> offs(n + 1, 0);
+    for (int i = 0; i < n; i++) {
+      if (sizes[i] > huff::max_size(Z_BLOCK, width)) // corrupt, do not even try to allocate it
+        return true;
+      offs[i + 1] = offs[i] + sizes[i];
+    }
+    uint8_t *in = new uint8_t[offs[n]];
+    if (fread(in, sizeof(uint8_t), offs[n], f) != size_t(offs[n])) {
+      delete[] in;
+      return true;
+    }
+
+    std::atomic<bool> err(false);
+    parallel::blocks(n, 1, [&](int start, int end) {
+      for (int i = start; i < end; i++) {
+        int64_t off = int64_t(Z_BLOCK) * i;
+        if (huff::decode(&in[offs[i]], sizes[i], &bytes[off], std::min(int64_t(Z_BLOCK), size - off), width))
+          err = true;
+      }
+    });
+    delete[] in;
+    return err;
+  }
+
+  bool save_compressed() {
+    FILE *f = fopen(SAVE_Z.c_str(), "wb");
+    if (f == NULL)
+      return true;
+    int err = 0;
+    if (fwrite(&VERSION, sizeof(int), 1, f) != 1)
+      err = 1;
+    if (write_z(f, phase1, N_FS1TWIST * sizeof(prun1), sizeof(prun1)))
+      err = 1;
+    if (write_z(f, phase1_dist, N_PHASE1_DIST, 1))
+      err = 1;
+    if (write_z(f, phase2, N_CORNUD2, 1))
+      err = 1;
+    if (write_z(f, precheck, N_CSLICE2, 1))
+      err = 1;
+    if (fclose(f) != 0)
+      err = 1;
+    if (err)
+      remove(SAVE_Z.c_str());
+    return err;
+  }
+
+  // Loads the default tables from the compressed file `f` (positioned after the version)
+  bool load_compressed(FILE *f) {
+    phase1 = new prun1[N_FS1TWIST];
+    phase1_dist = new uint8_t[N_PHASE1_DIST];
+    phase2 = new uint8_t[N_CORNUD2];
+    precheck = new uint8_t[N_CSLICE2];
+    int err = 0;
+    if (read_z(f, phase1, N_FS1TWIST * sizeof(prun1), sizeof(prun1)))
+      err = 1;
+    if (read_z(f, phase1_dist, N_PHASE1_DIST, 1))
+      err = 1;
+    if (read_z(f, phase2, N_CORNUD2, 1))
+      err = 1;
+    if (read_z(f, precheck, N_CSLICE2, 1))
+      err = 1;
+    if (fgetc(f) != EOF)
+      err = 1;
+    return err;
+  }
+
+  // Opens table file `name` right after the version, `NULL` if it does not exist or is of an older version
+  FILE *open_table(const std::string& name) {
+    FILE *f = fopen(name.c_str(), "rb");
+    int version;
+    if (f != NULL && (fread(&version, sizeof(int), 1, f) != 1 || version != VERSION)) {
+      fclose(f);
+      f = NULL; // table file of an older version, simply regenerate it
+    }
+    return f;
+  }
+
+  bool init(bool file, bool lowmem) {
     init_base();
+    init_remap2();
 
     if (!file) {
-      init_phase1();
-      init_phase2();
+      init_phase1(!lowmem);
+      init_phase2(lowmem);
       init_precheck();
       return true;
     }
 
-    FILE *f = fopen(SAVE.c_str(), "rb");
+    const std::string& save = lowmem ? SAVE_LOW : SAVE;
+    FILE *f = open_table(save);
     int err = 0;
 
+    if (f == NULL && !lowmem && (f = open_table(SAVE_Z)) != NULL) {
+      err = load_compressed(f);
+      fclose(f);
+      return err;
+    }
+    if (f == NULL && !lowmem) {
+      // The full tables always go through the file as this makes a long generation resumable
+      if (generate(std::numeric_limits<int64_t>::max()) || (f = open_table(save)) == NULL)
+        return true;
+    }
+
     if (f == NULL) {
-      init_phase1();
-      init_phase2();
+      init_phase1(false);
+      init_phase2(true);
       init_precheck();
 
-      f = fopen(SAVE.c_str(), "wb");
-      if (fwrite(phase1, sizeof(prun1), N_FS1TWIST, f) != N_FS1TWIST)
+      f = fopen(save.c_str(), "wb");
+      if (fwrite(&VERSION, sizeof(int), 1, f) != 1)
+        err = 1;
+      if (fwrite(phase1_dist, sizeof(uint8_t), N_PHASE1_DIST, f) != N_PHASE1_DIST)
         err = 1;
-      if (fwrite(phase2, sizeof(uint8_t), N_CORNUD2, f) != N_CORNUD2)
+      if (fwrite(phase2_dist, sizeof(uint8_t), N_PHASE2_DIST, f) != N_PHASE2_DIST)
         err = 1;
       if (fwrite(precheck, sizeof(uint8_t), N_CSLICE2, f) != N_CSLICE2)
         err = 1;
       if (err)
-        remove(SAVE.c_str()); // delete file if there was some error writing it
+        remove(save.c_str()); // delete file if there was some error writing it
     } else {
-      phase1 = new prun1[N_FS1TWIST];
-      phase2 = new uint8_t[N_CORNUD2];
+      phase1 = lowmem ? nullptr : new prun1[N_FS1TWIST];
+      phase1_dist = new uint8_t[N_PHASE1_DIST];
+      phase2 = lowmem ? nullptr : new uint8_t[N_CORNUD2];
+      phase2_dist = lowmem ? new uint8_t[N_PHASE2_DIST] : nullptr;
       precheck = new uint8_t[N_CSLICE2];
-      if (fread(phase1, sizeof(prun1), N_FS1TWIST, f) != N_FS1TWIST)
+      if (!lowmem && fread(phase1, sizeof(prun1), N_FS1TWIST, f) != N_FS1TWIST)
+        err = 1;
+      if (fread(phase1_dist, sizeof(uint8_t), N_PHASE1_DIST, f) != N_PHASE1_DIST)
+        err = 1;
+      if (!lowmem && fread(phase2, sizeof(uint8_t), N_CORNUD2, f) != N_CORNUD2)
         err = 1;
-      if (fread(phase2, sizeof(uint8_t), N_CORNUD2, f) != N_CORNUD2)
+      if (lowmem && fread(phase2_dist, sizeof(uint8_t), N_PHASE2_DIST, f) != N_PHASE2_DIST)
         err = 1;
       if (fread(precheck, sizeof(uint8_t), N_CSLICE2, f) != N_CSLICE2)
         err = 1;
+      if (fgetc(f) != EOF)
+        err = 1; // file is larger than expected
     }
 
     fclose(f);
     return err;
   }
 
+
+  bool init_phase2x(bool file) {
+    if (!file) {
+      fill_phase2x();
+      return false;
+    }
+
+    FILE *f = open_table(SAVE_PHASE2X);
+    int err = 0;
+
+    if (f == NULL) {
+      fill_phase2x();
+
+      f = fopen(SAVE_PHASE2X.c_str(), "wb");
+      if (fwrite(&VERSION, sizeof(int), 1, f) != 1)
+        err = 1;
+      if (fwrite(phase2x, sizeof(uint8_t), N_PHASE2X / 4, f) != N_PHASE2X / 4)
+        err = 1;
+      if (err)
+        remove(SAVE_PHASE2X.c_str());
+    } else {
+      phase2x = new uint8_t[N_PHASE2X / 4];
+      if (fread(phase2x, sizeof(uint8_t), N_PHASE2X / 4, f) != N_PHASE2X / 4)
+        err = 1;
+      if (fgetc(f) != EOF)
+        err = 1;
+    }
+
+    fclose(f);
+    return err;
+  }
+
+  bool init_phase2next(bool file) {
+    FILE *f = file ? open_table(SAVE_PHASE2NEXT) : NULL;
+    int err = 0;
+    phase2_next = new prun2[N_CORNUD2];
+
+    if (f == NULL) {
+      parallel::blocks(sym::N_CORNERS, 16, [&](int start, int end) {
+        fill_phase2_next(phase2, &phase2_next[coord::N_UDEDGES2 * start], start, end);
+      });
+      if (!file)
+        return false;
+
+      f = fopen(SAVE_PHASE2NEXT.c_str(), "wb");
+      if (fwrite(&VERSION, sizeof(int), 1, f) != 1)
+        err = 1;
+      if (fwrite(phase2_next, sizeof(prun2), N_CORNUD2, f) != N_CORNUD2)
+        err = 1;
+      if (err)
+        remove(SAVE_PHASE2NEXT.c_str());
+    } else {
+      if (fread(phase2_next, sizeof(prun2), N_CORNUD2, f) != N_CORNUD2)
+        err = 1;
+      if (fgetc(f) != EOF)
+        err = 1;
+    }
+
+    fclose(f);
+    return err;
+  }
+
+  void init_phase2raw() {
+    phase2raw = new uint8_t[N_PHASE2RAW / 2];
+    parallel::blocks(coord::N_CORNERS, 64, [&](int start, int end) {
+      for (int corners = start; corners < end; corners++) {
+        int tmp = sym::corners_sym[corners];
+        const uint8_t *row = &phase2[coord::N_UDEDGES2 * sym::coord_c(tmp)];
+        int s = sym::coord_s(tmp);
+
+        for (int udedges2 = 0; udedges2 < coord::N_UDEDGES2; udedges2 += 2) {
+          int dist1 = std::min(int(row[sym::conj_udedges2[udedges2][s]]), 15);
+          int dist2 = std::min(int(row[sym::conj_udedges2[udedges2 + 1][s]]), 15);
+          phase2raw[(coord::N_UDEDGES2 * corners + udedges2) >> 1] = dist1 | dist2 << 4;
+        }
+      }
+    });
+  }
+
+  bool interleave() {
+    int err = 0;
+    err |= numa::interleave(phase1, sizeof(prun1) * N_FS1TWIST);
+    err |= numa::interleave(phase1_dist, N_PHASE1_DIST);
+    err |= numa::interleave(phase2, N_CORNUD2);
+    err |= numa::interleave(phase2_next, sizeof(prun2) * N_CORNUD2);
+    err |= numa::interleave(phase2_dist, N_PHASE2_DIST);
+    err |= numa::interleave(precheck, N_CSLICE2);
+    err |= numa::interleave(phase2x, N_PHASE2X / 4);
+    err |= numa::interleave(phase2raw, N_PHASE2RAW / 2);
+    return err;
+  }
+
+
+  inline int get_1(int coord) { return phase1_dist[coord >> 2] >> 2 * (coord & 3) & 0x3; }
+  inline void set_1(int coord, int dist) { phase1_dist[coord >> 2] &= ~((~dist & 0x3) << 2 * (coord & 3)); }
+
+  // Phase 1 neighbour `m` of class `fs1sym` (given by its raw FLIP and SLICE) with TWIST `twist` as a table index
+  inline int neighbour1(int flip, int slice, int twist, int m) {
+    int fslice11 = coord::fslice1(coord::move_flip[flip][m], coord::slice_to_slice1(coord::move_edges4[slice][m]));
+    int tmp = sym::fslice1_sym[fslice11];
+    return coord::N_TWIST * sym::coord_c(tmp) + sym::conj_twist[coord::move_twist[twist][m]][sym::coord_s(tmp)];
+  }
+
+  // 2-bit phase 1 distances (3 marks an unreached entry) with only the solved entry filled
+  void start_phase1_dist() {
+    phase1_dist = new uint8_t[N_PHASE1_DIST];
+    std::fill(phase1_dist, phase1_dist + N_PHASE1_DIST, EMPTY);
+    set_1(coord::N_TWIST * sym::coord_c(sym::fslice1_sym[coord::fslice1(0, coord::SLICE1_SOLVED)]), 0);
+  }
+
+  /* Same BFS as `init_phase1()` but directly on the 2-bit `phase1_dist` table, which is all it needs as neighbours
+   * differ by at most 1 in distance; uses a quarter of the memory. Like `fill_phase2x()`, it switches to a backward
+   * search once half of the table is filled. Continues from layer `dist` with `count` entries already filled and
+   * calls `step()` like `bfs_phase2()`. */
+  void fill_phase1_dist(int dist, int count, const std::function<void(int, int)>& step = nullptr) {
+    int n_moves = std::bitset<64>(move::p1mask).count();
+    clock::time_point tick = clock::now();
+
+    while (count < N_FS1TWIST) {
+      bool backward = count > N_FS1TWIST / 2;
+      int coord = 0;
+
+      for (int fs1sym = 0; fs1sym < sym::N_FSLICE1; fs1sym++) {
+        int fslice1 = sym::fslice1_raw[fs1sym];
+        int flip = coord::fslice1_to_flip(fslice1);
+        int slice = coord::slice1_to_slice(coord::fslice1_to_slice1(fslice1));
+
+        for (int twist = 0; twist < coord::N_TWIST; twist++, coord++) {
+          int val = get_1(coord);
+          if (backward ? val != 3 : val != dist % 3) // re-expands older layers with the same value, but that is harmless
+            continue;
+
+          for (int m = 0; m < n_moves; m++) {
+            int coord1 = neighbour1(flip, slice, twist, m);
+
+            if (backward) {
+              // An empty entry has distance > `dist`, thus a filled neighbour matching mod 3 is at exactly `dist`
+              if (get_1(coord1) == dist % 3) {
+                set_1(coord, (dist + 1) % 3);
+                count++;
+                break;
+              }
+              continue;
+            }
+
+            if (get_1(coord1) != 3)
+              continue;
+            set_1(coord1, (dist + 1) % 3);
+            count++;
+
+            int fs1sym1 = coord1 / coord::N_TWIST;
+            int twist1 = coord1 % coord::N_TWIST;
+            int selfs = sym::fslice1_selfs[fs1sym1] >> 1;
+            for (int s = 1; selfs > 0; s++) {
+              if (selfs & 1) {
+                int coord2 = coord::N_TWIST * fs1sym1 + sym::conj_twist[twist1][s];
+                if (get_1(coord2) == 3) {
+                  set_1(coord2, (dist + 1) % 3);
+                  count++;
+                }
+              }
+              selfs >>= 1;
+            }
+          }
+        }
+      }
+
+      progress("phase 1 depth " + std::to_string(dist), count, N_FS1TWIST, tick);
+      dist++;
+      if (step)
+        step(dist, count);
+    }
+
+    for (int coord = N_FS1TWIST; coord < 4 * N_PHASE1_DIST; coord++)
+      set_1(coord, 0); // padding is 0 in `init_phase1()`
+  }
+
+  // Table entries of all classes in [`start`, `end`) into `entries` (starting with class `start`) from `phase1_dist`
+  void fill_phase1(prun1 *entries, int start, int end) {
+    int n_moves = std::bitset<64>(move::p1mask).count();
+
+    for (int fs1sym = start; fs1sym < end; fs1sym++) {
+      int fslice1 = sym::fslice1_raw[fs1sym];
+      int flip = coord::fslice1_to_flip(fslice1);
+      int slice = coord::slice1_to_slice(coord::fslice1_to_slice1(fslice1));
+
+      for (int twist = 0; twist < coord::N_TWIST; twist++) {
+        int coord = coord::N_TWIST * fs1sym + twist;
+        int val = get_1(coord);
+        int deltas[move::COUNT1] = {};
+        for (int m = 0; m < n_moves; m++) {
+          int diff = (get_1(neighbour1(flip, slice, twist, m)) - val + 3) % 3;
+          deltas[m] = diff == 2 ? -1 : diff;
+        }
+        entries[coord - coord::N_TWIST * start] = encode1(deltas);
+      }
+    }
+  }
+
+  // Generation stages, a checkpoint records the one to continue with
+  enum {
+    BFS1 = 1, // phase 1 BFS up to some layer done
+    ENTRIES1, // phase 1 BFS complete, entries written up to the size of the partial file
+    BFS2,
+    ENTRIES2
+  };
+
+  /* Stores the stage, BFS layer and count to continue from as well as the current distance table (the entries
+   * already written to the partial file are simply kept); replaces the old checkpoint atomically s.t. a crash at
+   * any point leaves a usable one. Failing to checkpoint is not an error, generation then just cannot resume. */
+  void save_checkpoint(int stage, int dist, int count, const uint8_t *data, size_t size) {
+    std::string tmp = CHECKPOINT + ".tmp";
+    FILE *f = fopen(tmp.c_str(), "wb");
+    if (f == NULL)
+      return;
+    int header[] = {VERSION, stage, dist, count};
+    bool err = fwrite(header, sizeof(int), 4, f) != 4 || fwrite(data, sizeof(uint8_t), size, f) != size;
+    if (fclose(f) != 0 || err)
+      remove(tmp.c_str());
+    else
+      rename(tmp.c_str(), CHECKPOINT.c_str());
+  }
+
+  // Stage of the current checkpoint (0 if there is no valid one); loads its distance table into `data`
+  int load_checkpoint(int& dist, int& count, uint8_t *&data) {
+    FILE *f = fopen(CHECKPOINT.c_str(), "rb");
+    if (f == NULL)
+      return 0;
+
+    int header[4];
+    int stage = 0;
+    if (fread(header, sizeof(int), 4, f) == 4 && header[0] == VERSION && BFS1 <= header[1] && header[1] <= ENTRIES2) {
+      size_t size = header[1] <= ENTRIES1 ? N_PHASE1_DIST : N_CORNUD2;
+      data = new uint8_t[size];
+      if (fread(data, sizeof(uint8_t), size, f) == size && fgetc(f) == EOF) {
+        stage = header[1];
+        dist = header[2];
+        count = header[3];
+      } else
+        delete[] data;
+    }
+    fclose(f);
+    return stage;
+  }
+
+  // Number of complete rows of `row` bytes in the partial file after `off` (at most `n`)
+  int written(FILE *f, int64_t off, int64_t row, int n) {
+    fseek(f, 0, SEEK_END);
+    return std::max(std::min((ftell(f) - off) / row, int64_t(n)), int64_t(0));
+  }
+
+  bool generate(int64_t mem) {
+    clock::time_point tick = clock::now();
+    int dist = 0;
+    int count = 0;
+    uint8_t *data = nullptr;
+    int stage = load_checkpoint(dist, count, data);
+
+    FILE *f = stage ? fopen(PART.c_str(), "r+b") : NULL;
+    if (f == NULL) {
+      if (stage)
+        delete[] data;
+      stage = 0;
+      if ((f = fopen(PART.c_str(), "wb")) == NULL)
+        return true;
+    } else
+      std::cout << "Resuming from checkpoint (stage " << stage << ", depth " << dist << ") ..." << std::endl;
+    int err = 0;
+    if (fwrite(&VERSION, sizeof(int), 1, f) != 1)
+      err = 1;
+
+    // All sections of the file in order
+    int64_t row1 = int64_t(coord::N_TWIST) * sizeof(prun1);
+    int64_t row2 = coord::N_UDEDGES2;
+    int64_t off1 = sizeof(int);
+    int64_t off2 = off1 + row1 * sym::N_FSLICE1 + N_PHASE1_DIST;
+    int64_t off3 = off2 + row2 * sym::N_CORNERS;
+
+    // Checkpointing after every BFS layer could easily take longer than the BFS itself
+    clock::time_point last = clock::now();
+    auto checkpoint = [&](int stage, int dist, int count, const uint8_t *data, size_t size) {
+      if (std::chrono::duration_cast<std::chrono::seconds>(clock::now() - last).count() >= CHECKPOINT_SECS) {
+        save_checkpoint(stage, dist, count, data, size);
+        last = clock::now();
+      }
+    };
+
+    if (stage <= ENTRIES1) {
+      if (stage == BFS1 || stage == ENTRIES1)
+        phase1_dist = data;
+      else {
+        start_phase1_dist();
+        count = 1;
+      }
+      if (stage <= BFS1) {
+        fill_phase1_dist(dist, count, [&](int dist, int count) {
+          checkpoint(BFS1, dist, count, phase1_dist, N_PHASE1_DIST);
+        });
+        save_checkpoint(ENTRIES1, 0, 0, phase1_dist, N_PHASE1_DIST);
+      }
+
+      // Everything except the buffer for the current chunk of classes (at least one) stays well below `mem`
+      int chunk1 = std::min(std::max((mem - N_PHASE1_DIST) / row1, int64_t(1)), int64_t(sym::N_FSLICE1));
+      prun1 *entries1 = new prun1[int64_t(coord::N_TWIST) * chunk1];
+      int start = stage == ENTRIES1 ? written(f, off1, row1, sym::N_FSLICE1) : 0;
+      fseek(f, off1 + row1 * start, SEEK_SET);
+      for (; start < sym::N_FSLICE1; start += chunk1) {
+        int end = std::min(start + chunk1, sym::N_FSLICE1);
+        parallel::blocks(end - start, 64, [&](int start1, int end1) {
+          fill_phase1(&entries1[coord::N_TWIST * start1], start + start1, start + end1);
+        });
+        size_t n = size_t(coord::N_TWIST) * (end - start);
+        if (fwrite(entries1, sizeof(prun1), n, f) != n || fflush(f) != 0)
+          err = 1;
+        if (10 * int64_t(end) / sym::N_FSLICE1 != 10 * int64_t(start) / sym::N_FSLICE1) // report in steps of 10%
+          progress("phase 1 entries", end, sym::N_FSLICE1, tick);
+      }
+      delete[] entries1;
+      if (fwrite(phase1_dist, sizeof(uint8_t), N_PHASE1_DIST, f) != N_PHASE1_DIST || fflush(f) != 0)
+        err = 1;
+      delete[] phase1_dist;
+      phase1_dist = nullptr;
+
+      stage = 0; // phase 2 starts from scratch
+      dist = 0;
+      count = 0;
+    }
+    if (err) {
+      fclose(f);
+      return true; // keep the checkpoint to retry from
+    }
+
+    uint8_t *dists = stage == BFS2 || stage == ENTRIES2 ? data : start_phase2();
+    if (stage <= BFS2) {
+      save_checkpoint(BFS2, dist, count, dists, N_CORNUD2); // phase 1 is complete, never redo it
+      bfs_phase2(dists, dist, count, [&](int dist, int count) {
+        checkpoint(BFS2, dist, count, dists, N_CORNUD2);
+      });
+      save_checkpoint(ENTRIES2, 0, 0, dists, N_CORNUD2);
+    }
+
+    // Phase 2 entries are just the distances
+    int start = stage == ENTRIES2 ? written(f, off2, row2, sym::N_CORNERS) : 0;
+    fseek(f, off2 + row2 * start, SEEK_SET);
+    size_t n = size_t(coord::N_UDEDGES2) * (sym::N_CORNERS - start);
+    if (fwrite(&dists[coord::N_UDEDGES2 * start], sizeof(uint8_t), n, f) != n || fflush(f) != 0)
+      err = 1;
+    delete[] dists;
+
+    init_precheck(); // takes only a moment
+    fseek(f, off3, SEEK_SET);
+    if (fwrite(precheck, sizeof(uint8_t), N_CSLICE2, f) != N_CSLICE2)
+      err = 1;
+    delete[] precheck;
+    precheck = nullptr;
+
+    if (fclose(f) != 0 || err)
+      return true;
+    if (rename(PART.c_str(), SAVE.c_str()) != 0)
+      return true;
+    remove(CHECKPOINT.c_str());
+    return false;
+  }
+
 }
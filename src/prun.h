@@ -5,7 +5,12 @@
 #ifndef __PRUN__
 #define __PRUN__
 
+#include <algorithm>
+#include <atomic>
 #include <cstdint>
+#ifdef __BMI2__
+  #include <immintrin.h>
+#endif
 #include "coord.h"
 #include "sym.h"
 
@@ -14,22 +19,260 @@ namespace prun {
   const int N_FS1TWIST = sym::N_FSLICE1 * coord::N_TWIST;
   const int N_CORNUD2 = sym::N_CORNERS * coord::N_UDEDGES2;
   const int N_CSLICE2 = coord::N_CORNERS * coord::N_SLICE2;
+  const int N_PHASE1_DIST = (N_FS1TWIST + 3) / 4; // 2 bits per entry
+  const int N_PHASE2_DIST = N_CORNUD2 / 2; // 4 bits per entry
+  const int N_SLICE2X = coord::N_SLICE2 / 2; // SLICE2 up to its parity
+  const int64_t N_PHASE2X = int64_t(sym::N_CORNERS) * N_SLICE2X * coord::N_UDEDGES2;
+  const int N_PHASE2RAW = coord::N_CORNERS * coord::N_UDEDGES2; // just fits into an `int`
 
   #ifdef AX
     using prun1 = uint64_t;
   #else
     using prun1 = uint32_t;
   #endif
+  // Smallest type holding two masks over the phase 2 moves
+  #if defined(AX) && !defined(QT)
+    using prun2 = uint64_t;
+  #elif defined(QT) && !defined(AX)
+    using prun2 = uint16_t;
+  #else
+    using prun2 = uint32_t;
+  #endif
+  static_assert(2 * move::COUNT_P2 <= 8 * sizeof(prun2), "phase 2 move-masks must fit into an entry");
+  const int N_CHUNKS2 = (move::COUNT_P2 + 7) / 8; // bytes of a phase 2 move-mask
+  #ifdef AX
+    const int BITS_PER_AX = 16; // bits used for encoding an axis in the ext. phase 1 table
+  #else
+    const int BITS_PER_AX = 8;
+  #endif
 
+  /* Phase 1 is split into a dense table of distances mod 3 (all a search usually needs) and one with the encoded next
+   * moves (only accessed for nodes close to the end of the current search) */
   extern prun1  *phase1;
+  extern uint8_t *phase1_dist;
   extern uint8_t *phase2;
+  /* Optional masks of the phase 2 moves decreasing the distance (lower `move::COUNT_P2` bits) and of those keeping it the
+   * same (above) per `phase2` entry; only looked at for nodes close to the end of the current search and hence kept
+   * apart from the dense distances. Loaded on request (`nullptr` otherwise). */
+  extern prun2 *phase2_next;
+  /* In low-memory mode, `phase1` and `phase2` are not loaded (`nullptr`) and move-masks are instead computed from the
+   * distances of all children; phase 2 distances are then stored in 4 bits (saturating at 15) */
+  extern uint8_t *phase2_dist;
   extern uint8_t *precheck;
+  /* Optional larger phase 2 table which also includes the SLICE2 permutation, i.e. gives the exact phase 2 distance.
+   * It takes several hundred MB even with 2-bit distances mod 3, hence it is only loaded on request (`nullptr`
+   * otherwise). */
+  extern uint8_t *phase2x;
+  /* Optional phase 2 table indexed directly by raw CORNERS x UDEDGES2 with 4 bits per entry (saturating at 15). It
+   * trades ~800MB for skipping the symmetry lookups of every single phase 2 node (`nullptr` if not loaded). */
+  extern uint8_t *phase2raw;
 
+  // Full phase 1 distance; this has to walk down to the goal, hence use only for search roots
   int get_phase1(int flip, int slice, int twist, int togo, move::mask& next);
+  int get_phase1(int fs1sym, int twist, int togo, move::mask& next); // FLIPSLICE1 as sym-coord
   int get_phase2(int corners, int udedges);
   int get_precheck(int corners, int slice);
 
-  bool init(bool file = true);
+  /* Hot search lookups are inlined */
+
+  #ifdef AX
+    // Symmetry permutation (indexed by the inverse and flip part of an effect) of the moves of an axis; split into
+    // lower and upper byte as a direct table for all 16-bit axis encodings would be several MB
+    extern uint16_t perm_ax[4][2][256];
+    extern uint8_t unzip_tbl[256]; // even bits of a byte in the lower, odd ones in the upper nibble
+  #else
+    // Used to remap symmetry ext. phase 1 table entries back to actual situation
+    extern move::mask remap[2][16][1 << BITS_PER_AX];
+  #endif
+
+  inline int ones(int count) { return (1 << count) - 1; }
+
+  #ifdef AX
+    // Split 8 2-bit move codes into their lower and upper bits
+    inline void unzip(int enc, int& lo, int& hi) {
+      #ifdef __BMI2__ // beware that PEXT is very slow on AMD CPUs before Zen 3
+        lo = _pext_u32(enc, 0x5555);
+        hi = _pext_u32(enc, 0xaaaa);
+      #else
+        int tmp = unzip_tbl[enc & 0xff] | unzip_tbl[enc >> 8] << 8;
+        lo = (tmp & 0xf) | (tmp >> 4 & 0xf0);
+        hi = (tmp >> 4 & 0xf) | (tmp >> 8 & 0xf0);
+      #endif
+    }
+  #endif
+
+  // Next moves of the axis encoded in `enc` remapped by symmetry effect `eff`
+  inline move::mask decode1(int delta, int eff, int enc) {
+    #ifdef AX
+      int p = eff & 0x3; // inverse and flip part of the effect
+      #ifdef QT
+        int lo, hi;
+        unzip(enc, lo, hi);
+        int mm = ~(delta ? hi : hi | lo) & 0xff; // codes are `delta` + 1
+        return move::mask(perm_ax[p][0][mm]) << (BITS_PER_AX / 2) * sym::eff_shift(eff);
+      #else
+        int mm = enc >> 1; // first bit encodes direction
+        mm = perm_ax[p][0][mm & 0xff] | perm_ax[p][1][mm >> 8];
+        int o = ones(BITS_PER_AX - 1);
+        if (enc & 1)
+          mm = delta ? ~mm & o : 0;
+        else
+          mm = delta ? o : ~mm & o;
+        return move::mask(mm) << (BITS_PER_AX - 1) * sym::eff_shift(eff);
+      #endif
+    #else
+      return remap[delta][eff][enc];
+    #endif
+  }
+
+  // Remaps a phase 2 move-mask of a class representative back to the actual position (byte by byte)
+  extern uint32_t remap2[sym::COUNT_SUB][N_CHUNKS2][256];
+  #if defined(QT) && !defined(AX)
+    extern move::mask quarter2; // phase 2 moves which are quarter-turns
+  #endif
+
+  inline int index_phase1(int fs1sym, int twist) {
+    return coord::N_TWIST * sym::coord_c(fs1sym) + sym::conj_twist[twist][sym::coord_s(fs1sym)];
+  }
+
+  // Distance of a neighbour of a position with distance `dist`
+  inline int get_dist1(int fs1sym, int twist, int dist) {
+    int coord = index_phase1(fs1sym, twist);
+    // Neighbours differ by at most 1 in distance, hence distance mod 3 fully determines the change
+    int delta = ((phase1_dist[coord >> 2] >> 2 * (coord & 3)) & 0x3) - dist % 3;
+    if (delta == 2)
+      return dist - 1;
+    if (delta == -2)
+      return dist + 1;
+    return dist + delta;
+  }
+
+  move::mask get_next1_dist(int fs1sym, int twist, int delta); // `get_next1()` in low-memory mode
+
+  // Moves to explore with `delta` = `togo` - distance
+  inline move::mask get_next1(int fs1sym, int twist, int delta) {
+    // `delta` < 0 case can never happen during a real search
+    if (delta > 1)
+      return move::p1mask; // all moves are possible
+    if (!phase1)
+      return get_next1_dist(fs1sym, twist, delta);
+
+    int s = sym::coord_s(fs1sym);
+    prun1 prun = phase1[index_phase1(fs1sym, twist)];
+    move::mask next = 0;
+    for (int ax = 0; ax < 3; ax++) {
+      next |= decode1(delta, sym::effect[s][ax], prun & ones(BITS_PER_AX));
+      prun >>= BITS_PER_AX;
+    }
+    return next & move::p1mask; // make sure to never try B-moves in F5-mode
+  }
+
+  inline int get_dist2(int corners, int udedges2) {
+    int tmp = sym::corners_sym[corners];
+    return phase2[coord::N_UDEDGES2 * sym::coord_c(tmp) + sym::conj_udedges2[udedges2][sym::coord_s(tmp)]];
+  }
+
+  // Phase 2 moves (as phase 2 indices) leading to a distance < `togo`, also gives the distance itself; in AXQT this may
+  // include some half-turns that do not, hence the child still has to check its distance
+  inline move::mask get_next2(int corners, int udedges2, int togo, int& dist) {
+    int tmp = sym::corners_sym[corners];
+    int s = sym::coord_s(tmp);
+    int coord = coord::N_UDEDGES2 * sym::coord_c(tmp) + sym::conj_udedges2[udedges2][s];
+
+    dist = phase2[coord];
+    int delta = togo - dist;
+    if (delta < 0)
+      return 0;
+    #if defined(QT) && !defined(AX)
+      if (delta > 2) // half-turns change the distance by 0 or 2 (parity) in vanilla QT
+    #else
+      if (delta > 1) // AXQT half-turns could increase the distance by 2 but masks cannot tell this from 1
+    #endif
+      return ones(move::COUNT_P2);
+
+    prun2 prun = phase2_next[coord];
+    move::mask next = 0;
+    for (int i = 0; i < N_CHUNKS2; i++)
+      next |= remap2[s][i][(prun >> 8 * i) & 0xff];
+    if (delta == 0)
+      return next;
+
+    prun >>= move::COUNT_P2;
+    for (int i = 0; i < N_CHUNKS2; i++)
+      next |= remap2[s][i][(prun >> 8 * i) & 0xff];
+    #if defined(QT) && !defined(AX)
+      if (delta == 2)
+        next |= quarter2;
+    #endif
+    return next;
+  }
+
+  // Smallest possible phase 2 distance >= `lb` (which must already have the right parity in vanilla QT mode); a search
+  // can use its parent's bound minus the move cost to make this exact for most nodes
+  inline int get_phase2x(int corners, int udedges2, int slice2, int lb) {
+    int tmp = sym::corners_sym[corners];
+    int s = sym::coord_s(tmp);
+    int64_t coord = (int64_t(N_SLICE2X) * sym::coord_c(tmp) + (sym::conj_slice2[slice2][s] >> 1)) *
+      coord::N_UDEDGES2 + sym::conj_udedges2[udedges2][s];
+    int dist = phase2x[coord >> 2] >> 2 * (coord & 3) & 0x3;
+    #if defined(QT) && !defined(AX)
+      int step = 2; // perm-parity determines whether the distance is odd or even
+    #else
+      int step = 1;
+    #endif
+    while (lb % 3 != dist)
+      lb += step;
+    return lb;
+  }
+
+  // Lower bound for the phase 2 distance without any symmetry lookups
+  inline int get_phase2raw(int corners, int udedges2) {
+    int coord = coord::N_UDEDGES2 * corners + udedges2;
+    return phase2raw[coord >> 1] >> 4 * (coord & 1) & 0xf;
+  }
+
+  // Phase 2 distance (saturating at 15) from the low-memory table
+  inline int get_phase2_dist(int corners, int udedges2) {
+    int tmp = sym::corners_sym[corners];
+    int coord = coord::N_UDEDGES2 * sym::coord_c(tmp) + sym::conj_udedges2[udedges2][sym::coord_s(tmp)];
+    return phase2_dist[coord >> 1] >> 4 * (coord & 1) & 0xf;
+  }
+
+  /* Classic small distance tables (FLIP/TWIST x SLICE1 and CORNERS/UDEDGES2 x SLICE2) which give much weaker bounds but
+   * are built in a fraction of a second; the search uses them as long as `ready` is false, i.e. the full tables can be
+   * loaded in the background and simply be enabled by setting `ready` afterwards */
+  extern std::atomic<bool> ready;
+  extern uint8_t *weak_fs1;
+  extern uint8_t *weak_ts1;
+  extern uint8_t *weak_cs2;
+  extern uint8_t *weak_us2;
+
+  inline int get_weak1(int flip, int slice1, int twist) {
+    return std::max(weak_fs1[coord::N_FLIP * slice1 + flip], weak_ts1[coord::N_TWIST * slice1 + twist]);
+  }
+
+  inline int get_weak2(int corners, int udedges2, int slice2) {
+    return std::max(weak_cs2[coord::N_SLICE2 * corners + slice2], weak_us2[coord::N_SLICE2 * udedges2 + slice2]);
+  }
+
+  inline int get_weak_precheck(int corners, int slice) {
+    return weak_cs2[coord::N_SLICE2 * corners + coord::slice_to_slice2(slice)];
+  }
+
+  bool init(bool file = true, bool lowmem = false);
+  // Writes the loaded default tables to `twophase-*.tbl.z`, which `init()` uses if there is no uncompressed file
+  bool save_compressed();
+  /* Writes the default table file without ever holding the full `phase1` or `phase2` tables in memory; entries are
+   * built in chunks of classes s.t. the peak stays around `mem` bytes (as long as this exceeds the distance tables
+   * needed to derive them). Progress is checkpointed to `twophase-*.tbl.ckpt` and an interrupted generation resumes
+   * from there. Does not load anything. */
+  bool generate(int64_t mem);
+  void init_weak(); // sets `ready` to false
+  bool init_phase2x(bool file = true); // call after `init()`
+  void init_phase2raw(); // derived from `phase2`, hence call after `init()`
+  bool init_phase2next(bool file = true); // derived from `phase2`, hence call after `init()`
+  // Spread all loaded tables over the NUMA nodes (see `numa.h`), migrating them if necessary; true if this failed
+  bool interleave();
 
 }
 
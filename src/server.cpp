@@ -0,0 +1,145 @@
+#include "server.h"
+
+#include <chrono>
+#include <condition_variable>
+#include <csignal>
+#include <cstring>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <queue>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+
+#include "proto.h"
+
+namespace server {
+
+  // Client connection; closed once the client is gone and no more of its requests are pending
+  struct conn {
+    int fd;
+    std::mutex mtx; // responses of different workers must not interleave
+
+    conn(int fd) : fd(fd) {}
+    ~conn() { close(fd); }
+
+    void respond(uint32_t id, int status, uint32_t time, const std::vector<std::vector<int>>& sols) {
+      std::vector<uint8_t> buf;
+      proto::encode(id, status, time, sols, buf);
+      std::lock_guard<std::mutex> lock(mtx);
+      proto::write_full(fd, buf.data(), buf.size()); // nothing to do if the client has already disconnected
+    }
+  };
+
+  struct job {
+    int priority;
+    uint64_t seq; // arrival order
+    std::shared_ptr<conn> client;
+    proto::request req;
+    cubie::cube c;
+    move::mask first;
+    move::mask last;
+  };
+
+  struct later {
+    bool operator()(const job& j1, const job& j2) {
+      return j1.priority != j2.priority ? j1.priority < j2.priority : j1.seq > j2.seq;
+    }
+  };
+
+  std::mutex queue_mtx;
+  std::condition_variable queue_cvar;
+  std::priority_queue<job, std::vector<job>, later> queue;
+  uint64_t seq = 0;
+
+  void worker(solve::Engine *solver) {
+    std::vector<std::vector<int>> sols;
+    while (true) {
+      solver->prepare(); // have the threads ready before the next request arrives
+
+      job j;
+      {
+        std::unique_lock<std::mutex> lock(queue_mtx);
+        queue_cvar.wait(lock, []{ return !queue.empty(); });
+        j = queue.top();
+        queue.pop();
+      }
+
+      solver->limits(j.req.tlim, j.req.n_sols, j.req.max_len);
+      auto tick = std::chrono::high_resolution_clock::now();
+      solver->solve(j.c, sols, j.first, j.last);
+      uint32_t time = std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::high_resolution_clock::now() - tick
+      ).count();
+      j.client->respond(j.req.id, proto::OK, time, sols);
+    }
+  }
+
+  void reader(std::shared_ptr<conn> client, move::mask first, move::mask last) {
+    job j;
+    j.client = client;
+    while (proto::read_full(client->fd, &j.req, sizeof(j.req))) {
+      j.first = first;
+      j.last = last;
+      int status = proto::decode(j.req, j.c, j.first, j.last);
+      if (status != proto::OK) { // invalid requests are answered right away
+        client->respond(j.req.id, status, 0, {});
+        continue;
+      }
+
+      j.priority = j.req.priority;
+      {
+        std::lock_guard<std::mutex> lock(queue_mtx);
+        j.seq = seq++;
+        queue.push(j);
+      }
+      queue_cvar.notify_one();
+    }
+    shutdown(client->fd, SHUT_RD); // the connection stays open for pending responses
+  }
+
+  void run(
+    const std::string& path, int n_workers, std::function<solve::Engine *()> engine,
+    move::mask first, move::mask last
+  ) {
+    sockaddr_un addr = {};
+    addr.sun_family = AF_UNIX;
+    if (path.size() >= sizeof(addr.sun_path)) {
+      std::cout << "Error: Socket path too long." << std::endl;
+      return;
+    }
+    strcpy(addr.sun_path, path.c_str());
+
+    // Remove a stale socket of a previous run, but never anything else (like a table file given by mistake)
+    struct stat st;
+    if (lstat(path.c_str(), &st) == 0) {
+      if (!S_ISSOCK(st.st_mode)) {
+        std::cout << "Error: Cannot listen on " << path << "." << std::endl;
+        return;
+      }
+      unlink(path.c_str());
+    }
+
+    int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (fd < 0 || bind(fd, (sockaddr *) &addr, sizeof(addr)) || listen(fd, 64)) {
+      std::cout << "Error: Cannot listen on " << path << "." << std::endl;
+      return;
+    }
+    signal(SIGPIPE, SIG_IGN); // a client disconnecting must not kill the daemon
+
+    for (int i = 0; i < n_workers; i++)
+      std::thread(worker, engine()).detach(); // engines live as long as the daemon
+    std::cout << "Serving on " << path << " with " << n_workers << " worker(s)." << std::endl;
+
+    while (true) {
+      int client = accept(fd, NULL, NULL);
+      if (client >= 0)
+        std::thread(reader, std::make_shared<conn>(client), first, last).detach();
+    }
+  }
+
+}
@@ -0,0 +1,28 @@
+/**
+ * Daemon mode: serves the binary protocol (see `proto.h`) to any number of local clients over a Unix domain socket.
+ * Tables are loaded only once for all of them. Requests of all connections are queued by priority (FIFO within the
+ * same priority) and solved by a pool of workers, each with its own engine. Clients may pipeline requests on a single
+ * connection; responses are then matched by their IDs as they are not necessarily returned in order.
+ */
+
+#ifndef __SERVER__
+#define __SERVER__
+
+#include <functional>
+#include <string>
+
+#include "move.h"
+#include "solve.h"
+
+namespace server {
+
+  /* Accepts connections on `path` and serves them forever with `n_workers` engines created via `engine`; `first` and
+   * `last` are the default move restrictions. Returns only if the socket cannot be set up. */
+  void run(
+    const std::string& path, int n_workers, std::function<solve::Engine *()> engine,
+    move::mask first, move::mask last
+  );
+
+}
+
+#endif
@@ -3,20 +3,47 @@
 #include <algorithm>
 #include <cstring>
 #include <thread>
+#include <vector>
+#include "numa.h"
 #include "prun.h"
 #include "sym.h"
 
 namespace solve {
 
+  // Global state of the core sharing
+  std::mutex share_mtx;
+  std::condition_variable share_cvar;
+  int n_cores = 0; // 0 means no sharing, i.e. every thread simply runs
+  int policy;
+  int n_free; // cores not held by any thread
+  std::vector<Engine *> active; // engines currently solving
+  uint64_t tickets = 0; // waiting order
+  std::atomic<int> n_waiting(0); // threads waiting for a core; lets `yield()` return right away in the common case
+
+  const int YIELD_NODES = 1 << 12; // phase 1 nodes between checks whether to hand the core over
+
+  void share(int n_cores1, int policy1) {
+    std::lock_guard<std::mutex> lock(share_mtx);
+    n_cores = n_cores1;
+    n_free = n_cores1;
+    policy = policy1;
+  }
+
   class Search {
 
     int dir; // ID of search direction
     const coordc& cube; // starting position
     int p1depth; // phase 1 search depth
     move::mask d0moves; // mask for initial moves to consider
+    move::mask last; // mask for final moves to consider
+    move::mask last2; // `last` in terms of phase 2 moves
     bool& done; // when to terminate the search
     int& lenlim; // only find strictly shorter solutions
     Engine& solver; // report solutions to
+    std::atomic<uint64_t> *p2tt; // phase 2 transposition table
+    int epoch; // current epoch of `p2tt`
+    bool order; // see `Engine::order`
+    bool weak; // only the weak tables are available (see `prun::ready`)
 
     /* Keep track of reconstructed edges that remain valid in the current search path */
     int uedges[50];
@@ -24,91 +51,133 @@ namespace solve {
     int edges_depth;
 
     int moves[50]; // current (partial) solution
+    int nodes; // phase 1 nodes since the last `Engine::yield()`
+    bool held; // thread still holds its core (see `share()`)
 
   private:
     void phase1(
+      int depth, int togo, int fs1sym, int slice, int twist, int corners, int dist, move::mask next, move::mask qt_skip
+    ); // phase 1 search; iterates through all solution with exactly `togo` moves; FLIPSLICE1 is tracked as sym-coord
+    void phase1_weak(
       int depth, int togo, int flip, int slice, int twist, int corners, move::mask next, move::mask qt_skip
-    ); // phase 1 search; iterates through all solution with exactly `togo` moves
+    ); // same but with the weak tables and on raw coordinates
+    void finish1(int depth, int slice, int corners, move::mask qt_skip); // searches phase 2 from a phase 1 end state
     bool phase2(
-      int depth, int togo, int slice, int udedges2, int corners, move::mask next, move::mask qt_skip
-    ); // phase 2 search; returns once any solution is found
+      int depth, int togo, int dist, int slice2, int udedges2, int corners, move::mask next, move::mask qt_skip
+    ); // phase 2 search (on phase 2 move indices); returns once any solution is found
 
   public:
     Search(
       int dir,
       const coordc& cube,
-      int p1depth, move::mask d0moves,
-      bool& done, int& lenlim, Engine& solver
-    ) : dir(dir), cube(cube), p1depth(p1depth), d0moves(d0moves), done(done), lenlim(lenlim), solver(solver) {};
-    void run(); // perform the search
+      int p1depth, move::mask d0moves, move::mask last,
+      bool& done, int& lenlim, Engine& solver,
+      std::atomic<uint64_t> *p2tt, int epoch, bool order, bool weak
+    ) :
+      dir(dir), cube(cube), p1depth(p1depth), d0moves(d0moves), last(last), last2(move::to_p2(last)),
+      done(done), lenlim(lenlim), solver(solver), p2tt(p2tt), epoch(epoch), order(order), weak(weak), nodes(0), held(true)
+    {};
+    bool run(); // perform the search; returns whether the thread still holds its core
 
   };
 
-  void Search::run() {
+  bool Search::run() {
     uedges[0] = cube.uedges;
     dedges[0] = cube.dedges;
     edges_depth = 0;
 
-    move::mask next;
-    prun::get_phase1(cube.flip, cube.slice, cube.twist, p1depth, next);
-    next &= move::p1mask & d0moves; // block B-moves in F5 mode here and select current search split
-    phase1(0, p1depth, cube.flip, cube.slice, cube.twist, cube.corners, next, 0);
+    if (weak) {
+      phase1_weak(0, p1depth, cube.flip, cube.slice, cube.twist, cube.corners, move::p1mask & d0moves, 0);
+      return held;
+    }
+    move::mask next = prun::get_next1(cube.fs1sym, cube.twist, p1depth - cube.dist1);
+    next &= d0moves; // select current search split
+    phase1(0, p1depth, cube.fs1sym, cube.slice, cube.twist, cube.corners, cube.dist1, next, 0);
+    return held;
   }
 
   void Search::phase1(
-    int depth, int togo, int flip, int slice, int twist, int corners, move::mask next, move::mask qt_skip
+    int depth, int togo, int fs1sym, int slice, int twist, int corners, int dist, move::mask next, move::mask qt_skip
   ) {
     if (done)
       return;
-    if (togo == 0) {
-      int tmp = prun::get_precheck(corners, slice);
-      if (tmp >= lenlim - depth) // phase 2 precheck, only reconstruct edges if successful
+    if (++nodes == YIELD_NODES) { // give other solves a chance to run (see `share()`)
+      nodes = 0;
+      if (!(held = solver.yield()))
         return;
+    }
+    if (togo == 0) {
+      finish1(depth, slice, corners, qt_skip);
+      return;
+    }
+
+    depth++;
+    togo--;
 
-      for (int i = edges_depth + 1; i <= depth; i++) {
-        uedges[i] = coord::move_edges4[uedges[i - 1]][moves[i - 1]];
-        dedges[i] = coord::move_edges4[dedges[i - 1]][moves[i - 1]];
+    if (order && togo == 0) {
+      // Try the end states with the smallest phase 2 estimate first as they are most likely to give a short solution
+      // before time runs out or `lenlim` drops
+      int ms[move::COUNT_P1];
+      int ests[move::COUNT_P1];
+      int n = 0;
+      while (next) {
+        int m = ffsll(next) - 1;
+        next &= next - 1;
+        if (dist != 1 && prun::get_dist1(sym::move_fslice1(fs1sym, m), coord::move_twist[twist][m], dist) != 0)
+          continue; // see below
+
+        int est = prun::get_precheck(coord::move_corners[corners][m], coord::move_edges4[slice][m]);
+        int i = n++;
+        for (; i > 0 && ests[i - 1] > est; i--) { // insertion sort is best for so few moves
+          ms[i] = ms[i - 1];
+          ests[i] = ests[i - 1];
+        }
+        ms[i] = m;
+        ests[i] = est;
       }
-      edges_depth = depth - 1;
-      int udedges2 = coord::merge_udedges2(uedges[depth], dedges[depth]);
 
-      int delta = 1;
-      #ifndef AX
+      for (int i = 0; i < n; i++) {
+        int m = ms[i];
+        moves[depth - 1] = m;
+        move::mask qt_skip1 = 0;
         #ifdef QT
-          delta++; // in vanilla QT mode the perm-parity indicates whether solution length is odd or even
+          qt_skip1 = move::qt_skip[m];
         #endif
-      #endif
-      for (int togo1 = std::max(prun::get_phase2(corners, udedges2), tmp); togo1 < lenlim - depth; togo1 += delta) {
-        if (phase2(depth, togo1, slice, udedges2, corners, move::p2mask & move::next_p1p2[moves[depth - 1]], qt_skip))
-          return; // once we have found a phase 2 solution, there cannot be any shorter ones -> quit
+        // `next` is not needed at the end of phase 1
+        phase1(
+          depth, 0, sym::move_fslice1(fs1sym, m), coord::move_edges4[slice][m], coord::move_twist[twist][m],
+          coord::move_corners[corners][m], 0, 0, qt_skip1
+        );
       }
+
+      if (edges_depth == depth - 1)
+        edges_depth--;
       return;
     }
 
-    depth++;
-    togo--;
     while (next) {
       int m = ffsll(next) -  1; // get rightmost move index (`ffsll()` uses 1-based indexing)
       next &= next - 1;
 
-      int flip1 = coord::move_flip[flip][m];
-      int slice1 = coord::move_edges4[slice][m];
+      int fs1sym1 = sym::move_fslice1(fs1sym, m);
       int twist1 = coord::move_twist[twist][m];
-      move::mask next1;
-      int dist1 = prun::get_phase1(flip1, slice1, twist1, togo, next1);
+      // If the parent had no slack, `next` contains only moves that bring us closer
+      int dist1 = dist == togo + 1 ? togo : prun::get_dist1(fs1sym1, twist1, dist);
 
       // Check inside loop to avoid unnecessary recursion unwinds
       if (dist1 == togo || dist1 + togo >= 5) { // Rokicki optimization
+        int slice1 = coord::move_edges4[slice][m];
         int corners1 = coord::move_corners[corners][m];
         moves[depth - 1] = m;
 
-        next1 &= move::p1mask & move::next[m];
+        // Only now touch the (much larger) next move table
+        move::mask next1 = prun::get_next1(fs1sym1, twist1, togo - dist1) & move::next[m];
         move::mask qt_skip1;
         #ifdef QT // let `qt_skip` get completely optimized away when not in QT-mode
           qt_skip1 = move::qt_skip[m];
           next1 &= ~(qt_skip & qt_skip1);
         #endif
-        phase1(depth, togo, flip1, slice1, twist1, corners1, next1, qt_skip1);
+        phase1(depth, togo, fs1sym1, slice1, twist1, corners1, dist1, next1, qt_skip1);
       }
     }
 
@@ -119,11 +188,124 @@ namespace solve {
       edges_depth--;
   }
 
+  void Search::finish1(int depth, int slice, int corners, move::mask qt_skip) {
+    int tmp = weak ? prun::get_weak_precheck(corners, slice) : prun::get_precheck(corners, slice);
+    if (tmp >= lenlim - depth) // phase 2 precheck, only reconstruct edges if successful
+      return;
+
+    for (int i = edges_depth + 1; i <= depth; i++) {
+      uedges[i] = coord::move_edges4[uedges[i - 1]][moves[i - 1]];
+      dedges[i] = coord::move_edges4[dedges[i - 1]][moves[i - 1]];
+    }
+    edges_depth = depth - 1;
+    int udedges2 = coord::merge_udedges2(uedges[depth], dedges[depth]);
+
+    int delta = 1;
+    #ifndef AX
+      #ifdef QT
+        delta++; // in vanilla QT mode the perm-parity indicates whether solution length is odd or even
+      #endif
+    #endif
+    // Without any phase 1 moves, the first phase 2 move is also the first move of the solution
+    move::mask next = depth > 0 ? move::next_p1p2[moves[depth - 1]] : move::to_p2(d0moves);
+    #ifdef QT
+      qt_skip = move::to_p2(qt_skip);
+    #endif
+    int slice2 = coord::slice_to_slice2(slice);
+    int togo1 = std::max(weak ? prun::get_weak2(corners, udedges2, slice2) : prun::get_phase2(corners, udedges2), tmp);
+    if (!weak && prun::phase2x)
+      togo1 = prun::get_phase2x(corners, udedges2, slice2, togo1);
+    int dist2 = togo1; // lower bound for the phase 2 distance
+
+    // Phase 2 also depends on the last phase 1 move (and thereby on `next` and `qt_skip`) as well as the direction
+    // (through `last`); the empty phase 1 case is rare and not worth the trouble
+    uint64_t key = 0;
+    std::atomic<uint64_t> *entry = nullptr;
+    if (depth > 0) {
+      key = uint64_t(N_DIRS) * (
+        move::COUNT * (coord::N_SLICE2 * (uint64_t(coord::N_UDEDGES2) * corners + udedges2) + slice2) + moves[depth - 1]
+      ) + dir;
+      entry = &p2tt[(key * 0x9e3779b97f4a7c15) >> (64 - P2TT_BITS)];
+      uint64_t val = entry->load(std::memory_order_relaxed);
+      if (val >> 14 == key && (val >> 6 & 0xff) == uint64_t(epoch)) {
+        int bound = val & 0x3f;
+        if (bound >= lenlim - depth)
+          return; // we would only repeat the same fruitless search
+        while (togo1 < bound) // resume where the last attempt stopped
+          togo1 += delta;
+      }
+    }
+
+    for (; togo1 < lenlim - depth; togo1 += delta) {
+      if (phase2(depth, togo1, dist2, slice2, udedges2, corners, next, qt_skip))
+        return; // once we have found a phase 2 solution, there cannot be any shorter ones -> quit
+    }
+    if (entry) // there is no solution with < `togo1` phase 2 moves
+      entry->store(key << 14 | uint64_t(epoch) << 6 | togo1, std::memory_order_relaxed);
+  }
+
+  void Search::phase1_weak(
+    int depth, int togo, int flip, int slice, int twist, int corners, move::mask next, move::mask qt_skip
+  ) {
+    if (done)
+      return;
+    if (++nodes == YIELD_NODES) { // give other solves a chance to run (see `share()`)
+      nodes = 0;
+      if (!(held = solver.yield()))
+        return;
+    }
+    if (togo == 0) {
+      finish1(depth, slice, corners, qt_skip);
+      return;
+    }
+
+    depth++;
+    togo--;
+
+    while (next) {
+      int m = ffsll(next) - 1;
+      next &= next - 1;
+
+      int flip1 = coord::move_flip[flip][m];
+      int slice1 = coord::move_edges4[slice][m];
+      int twist1 = coord::move_twist[twist][m];
+      int dist1 = prun::get_weak1(flip1, coord::slice_to_slice1(slice1), twist1);
+      // The weak bound is only exact for positions already in phase 2, which is also all Rokicki's optimization needs
+      if (dist1 > togo || (dist1 == 0 && togo > 0 && togo < 5))
+        continue;
+
+      moves[depth - 1] = m;
+      move::mask next1 = move::next[m] & move::p1mask;
+      move::mask qt_skip1 = 0;
+      #ifdef QT
+        qt_skip1 = move::qt_skip[m];
+        next1 &= ~(qt_skip & qt_skip1);
+      #endif
+      phase1_weak(depth, togo, flip1, slice1, twist1, coord::move_corners[corners][m], next1, qt_skip1);
+    }
+
+    if (edges_depth == depth - 1)
+      edges_depth--;
+  }
+
   bool Search::phase2(
-    int depth, int togo, int slice, int udedges2, int corners, move::mask next, move::mask qt_skip
+    int depth, int togo, int dist, int slice2, int udedges2, int corners, move::mask next, move::mask qt_skip
   ) {
+    // With the move-masks, pruning happens here rather than in the parent as they directly give the moves worth trying
+    // (otherwise, the parent has already checked the distances of all children)
+    bool masks = !weak && prun::phase2_next && !prun::phase2raw;
+    int dist1 = dist;
+    if (masks)
+      next &= prun::get_next2(corners, udedges2, togo, dist1);
+    if (!weak && prun::phase2x)
+      dist1 = prun::get_phase2x(corners, udedges2, slice2, std::max(dist, dist1));
+    if (dist1 > togo) // only possible with AXQT half-turns or the extended table
+      return false;
+
     if (togo == 0) {
-      if (slice != coord::N_SLICE2 * coord::SLICE1_SOLVED) // check if SLICE2 is also solved
+      if (slice2 != 0) // check if SLICE2 is also solved
+        return false;
+      if (depth > 0 && !move::in(moves[depth - 1], last)) // only relevant if phase 2 is empty
         return false;
 
       searchres sol = {std::vector<int>(depth), dir };
@@ -134,42 +316,56 @@ namespace solve {
       return true; // we will not find any shorter solutions
     }
 
+    // Prune all moves that would violate the last move constraint before even looking at them
+    if (togo == 1)
+      next &= last2;
+
     while (next) {
-      int m = ffsll(next) -  1; // get rightmost move index (`ffsll()` uses 1-based indexing)
+      int i = ffsll(next) -  1; // get rightmost move index (`ffsll()` uses 1-based indexing)
       next &= next - 1;
 
-      int slice1 = coord::move_edges4[slice][m];
-      int udedges21 = coord::move_udedges2[udedges2][m];
-      int corners1 = coord::move_corners[corners][m];
-
-      if (prun::get_phase2(corners1, udedges21) < togo) {
-        #ifdef QT
-          // As we never want to leave the set of phase 2 cubes (which we would by doing only a quarter-turn on an axis
-          // for which only double-moves are permitted), we need special handling of the double moves. The simplest way
-          // to do this is to treat a double moves simply as if two consecutive quarter-turns were added to the current
-          // search path.
-          if (m >= move::COUNT1) {
-            if (togo <= 1) // we cannot do half turns when only a single quarter-turn is permitted
-              break;
-
-            int tmp = move::split[m];
-            moves[depth] = tmp;
-            moves[depth + 1] = tmp;
-
-            move::mask next1 = move::p2mask & move::next[m];
-            move::mask qt_skip1 = move::qt_skip[m];
-            next1 &= ~(qt_skip & qt_skip1);
-
-            if (phase2(depth + 2, togo - 2, slice1, udedges21, corners1, next1, qt_skip1))
-              return true;
+      int slice21 = coord::move_slice2[slice2][i];
+      int udedges21 = coord::move_udedges2[udedges2][i];
+      int corners1 = coord::move_corners2[corners][i];
+      int m = move::p2moves[i];
+      int dist2 = 0; // lower bound for the distance of the child
+      if (weak)
+        dist2 = prun::get_weak2(corners1, udedges21, slice21);
+      else if (prun::phase2raw)
+        dist2 = prun::get_phase2raw(corners1, udedges21);
+      else if (!masks)
+        dist2 = prun::phase2 ? prun::get_dist2(corners1, udedges21) : prun::get_phase2_dist(corners1, udedges21);
+      if (dist2 >= togo)
+        continue;
+
+      #ifdef QT
+        // As we never want to leave the set of phase 2 cubes (which we would by doing only a quarter-turn on an axis
+        // for which only double-moves are permitted), we need special handling of the double moves. The simplest way
+        // to do this is to treat a double moves simply as if two consecutive quarter-turns were added to the current
+        // search path.
+        if (m >= move::COUNT1) {
+          if (togo <= 1) // we cannot do half turns when only a single quarter-turn is permitted
+            break;
+          if (togo == 2 && !move::in(i, last2)) // a final half-turn is split into two quarter-turns
             continue;
-          }
-        #endif
 
-        moves[depth] = m;
-        if (phase2(depth + 1, togo - 1, slice1, udedges21, corners1, move::p2mask & move::next[m], 0))
-          return true; // return as soon as we have a solution
-      }
+          int tmp = move::split[m];
+          moves[depth] = tmp;
+          moves[depth + 1] = tmp;
+
+          move::mask next1 = move::next2[i];
+          move::mask qt_skip1 = move::qt_skip2[i];
+          next1 &= ~(qt_skip & qt_skip1);
+
+          if (phase2(depth + 2, togo - 2, std::max(dist2, dist1 - 2), slice21, udedges21, corners1, next1, qt_skip1))
+            return true;
+          continue;
+        }
+      #endif
+
+      moves[depth] = m;
+      if (phase2(depth + 1, togo - 1, std::max(dist2, dist1 - 1), slice21, udedges21, corners1, move::next2[i], 0))
+        return true; // return as soon as we have a solution
     }
 
     return false;
@@ -177,12 +373,34 @@ namespace solve {
 
   Engine::Engine(
     int n_threads, int tlim,
-    int n_sols, int max_len, int n_splits
-  ) : n_threads(n_threads), tlim(tlim), n_sols(n_sols), max_len(max_len), n_splits(n_splits) {
+    int n_sols, int max_len, int n_splits, bool order
+  ) : n_threads(n_threads), tlim(tlim), n_sols(n_sols), max_len(max_len), n_splits(n_splits), order(order),
+    dflt_tlim(tlim), dflt_n_sols(n_sols), dflt_max_len(max_len) {
     int tmp = (move::COUNT1 + n_splits - 1) / n_splits; // ceil to make sure that we always include all moves
-    for (int i = 0; i < n_splits; i++)
+    for (int i = 0; i < n_splits; i++) {
       masks[i] = (move::mask(1) << tmp) - 1 << tmp * i;
+      #ifdef QT
+        for (int m = move::COUNT1; m < move::COUNT; m++) { // half-turns may start a search that is pure phase 2
+          if (move::in(move::split[m], masks[i]))
+            masks[i] |= move::bit(m);
+        }
+      #endif
+    }
     done = true; // make sure that the first `prepare()` will actually do something
+    running = false;
+    used = 0;
+    waiting = 0;
+
+    p2tt = new std::atomic<uint64_t>[1 << P2TT_BITS];
+    for (int i = 0; i < (1 << P2TT_BITS); i++)
+      p2tt[i] = 0;
+    p2tt_epoch = 0;
+    numa::interleave(p2tt, sizeof(std::atomic<uint64_t>) * (1 << P2TT_BITS));
+    slot = numa::reserve(n_threads);
+  }
+
+  Engine::~Engine() {
+    delete[] p2tt;
   }
 
   void Engine::thread() {
@@ -190,6 +408,10 @@ namespace solve {
     do {
       /* Select next job to execute; don't forget to lock */
       job_mtx.lock();
+      if (done) { // released by `finish()` without ever solving
+        job_mtx.unlock();
+        break;
+      }
       for (int dir = 0; dir < N_DIRS; dir++) {
         if (depths[dir] < depths[mindir])
           mindir = dir;
@@ -202,8 +424,14 @@ namespace solve {
       }
       job_mtx.unlock();
 
-      Search search(mindir, dirs[mindir], togo, masks[split], done, lenlim, *this);
-      search.run();
+      if (!acquire())
+        break;
+      Search search(
+        mindir, dirs[mindir], togo, masks[split] & firsts[mindir], lasts[mindir], done, lenlim, *this,
+        p2tt, p2tt_epoch, order, weak
+      );
+      if (search.run())
+        release();
     } while (!done); // we should never actually get to the truly optimal depth anyways in general
   }
 
@@ -214,16 +442,36 @@ namespace solve {
 
     job_mtx.lock(); // make spawned threads wait for initialization of the cube to be solved
     for (int i = 0; i < n_threads; i++)
-      threads.push_back(std::thread([&]() { this->thread(); }));
+      threads.push_back(std::thread([&, i]() {
+        if (slot >= 0)
+          numa::pin(slot + i);
+        this->thread();
+      }));
 
     done = false;
-    lenlim = max_len > 0 ? max_len + 1: 50; // only search for strictly shorter solutions than this
     // `sols` is always emptied after a solve
   }
 
-  void Engine::solve(const cubie::cube& c, std::vector<std::vector<int>>& res) {
+  void Engine::limits(int tlim, int n_sols, int max_len) {
+    this->tlim = tlim ? tlim : dflt_tlim;
+    this->n_sols = n_sols ? n_sols : dflt_n_sols;
+    this->max_len = max_len ? max_len : dflt_max_len;
+  }
+
+  void Engine::solve(
+    const cubie::cube& c, std::vector<std::vector<int>>& res, move::mask first, move::mask last
+  ) {
     prepare(); // make sure we are prepared; will do nothing if that should already be the case
 
+    // Invalidate all phase 2 transposition table entries; only clear the table explicitly once epochs wrap around
+    if (++p2tt_epoch == 256) {
+      for (int i = 0; i < (1 << P2TT_BITS); i++)
+        p2tt[i].store(0, std::memory_order_relaxed);
+      p2tt_epoch = 1;
+    }
+
+    weak = !prun::ready.load(std::memory_order_acquire); // fixed for the whole solve
+
     cubie::cube tmp1, tmp2;
     cubie::cube invc;
     cubie::inv(c, invc);
@@ -240,12 +488,45 @@ namespace solve {
       dirs[dir].uedges = coord::get_uedges(tmp2);
       dirs[dir].dedges = coord::get_dedges(tmp2);
       dirs[dir].corners = coord::get_corners(tmp2);
+      dirs[dir].fs1sym = sym::fslice1_sym[coord::fslice1(dirs[dir].flip, coord::slice_to_slice1(dirs[dir].slice))];
 
       move::mask tmp; // simply ignore, makes no sense anyways without proper `togo`
-      depths[dir] = prun::get_phase1(dirs[dir].flip, dirs[dir].slice, dirs[dir].twist, 100, tmp);
+      if (weak)
+        dirs[dir].dist1 = prun::get_weak1(dirs[dir].flip, coord::slice_to_slice1(dirs[dir].slice), dirs[dir].twist);
+      else
+        dirs[dir].dist1 = prun::get_phase1(dirs[dir].fs1sym, dirs[dir].twist, 100, tmp);
+      depths[dir] = dirs[dir].dist1;
       splits[dir] = 0;
+
+      // Translate move constraints into the frame of the search direction (see undoing below); note that an inverse
+      // search finds the actual last move first
+      firsts[dir] = 0;
+      lasts[dir] = 0;
+      for (int m = 0; m < move::COUNT1; m++) {
+        int m1 = sym::conj_move[m][rot];
+        if (dir & 1)
+          m1 = move::inv[m1];
+        if (move::in(m1, (dir & 1) ? last : first))
+          firsts[dir] |= move::bit(m);
+        if (move::in(m1, (dir & 1) ? first : last))
+          lasts[dir] |= move::bit(m);
+      }
+      #ifdef QT
+        for (int m = move::COUNT1; m < move::COUNT; m++) { // half-turns are reported as two quarter-turns
+          if (move::in(move::split[m], firsts[dir]))
+            firsts[dir] |= move::bit(m);
+          if (move::in(move::split[m], lasts[dir]))
+            lasts[dir] |= move::bit(m);
+        }
+      #endif
     }
 
+    lenlim = max_len > 0 ? max_len + 1: 50; // only search for strictly shorter solutions than this
+    {
+      std::lock_guard<std::mutex> lock(tout_mtx);
+      running = true;
+    }
+    enter();
     job_mtx.unlock(); // start solving
 
     { // timeout
@@ -253,7 +534,9 @@ namespace solve {
       tout_cvar.wait_for(lock, std::chrono::milliseconds(tlim), [&]{ return done; });
       if (!done)
         done = true; // if we get here, this was a timeout
+      running = false;
     }
+    leave(); // wakes up any threads still waiting for a core
     std::lock_guard<std::mutex> lock(sol_mtx); // make sure no thread is writing any more solutions
 
     res.resize(sols.size());
@@ -296,7 +579,100 @@ namespace solve {
     }
   }
 
+  void Engine::enter() {
+    if (!n_cores)
+      return;
+    std::lock_guard<std::mutex> lock(share_mtx);
+    deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(tlim);
+    active.push_back(this);
+    share_cvar.notify_all(); // shares of the other solves shrink
+  }
+
+  void Engine::leave() {
+    if (!n_cores)
+      return;
+    std::lock_guard<std::mutex> lock(share_mtx);
+    active.erase(std::find(active.begin(), active.end(), this));
+    share_cvar.notify_all();
+  }
+
+  int64_t Engine::rank(int held) const {
+    return policy == DEADLINE ? deadline.time_since_epoch().count() : held;
+  }
+
+  bool Engine::may_run() const {
+    if (n_free == 0)
+      return false;
+    for (Engine *e : active) { // the waiting engine with the smallest (rank, since) goes first
+      if (e != this && e->waiting > 0 && std::make_pair(e->rank(e->used), e->since) < std::make_pair(rank(used), since))
+        return false;
+    }
+    return true;
+  }
+
+  bool Engine::wait_core(std::unique_lock<std::mutex>& lock) {
+    if (waiting++ == 0)
+      since = tickets++;
+    n_waiting++;
+    share_cvar.wait(lock, [&]{ return done || may_run(); });
+    n_waiting--;
+    if (--waiting > 0)
+      since = tickets++; // the remaining threads queue up again behind the other engines
+    if (done) {
+      share_cvar.notify_all(); // we might have been the reason for others to wait
+      return false;
+    }
+    n_free--;
+    used++;
+    return true;
+  }
+
+  bool Engine::acquire() {
+    if (!n_cores)
+      return true;
+    std::unique_lock<std::mutex> lock(share_mtx);
+    return wait_core(lock);
+  }
+
+  void Engine::release() {
+    if (!n_cores)
+      return;
+    std::lock_guard<std::mutex> lock(share_mtx);
+    n_free++;
+    used--;
+    share_cvar.notify_all();
+  }
+
+  bool Engine::yield() {
+    if (!n_cores || n_waiting.load(std::memory_order_relaxed) == 0)
+      return true;
+    std::unique_lock<std::mutex> lock(share_mtx);
+    // Would some other thread go first if we queued up again? Our own waiting threads always do, as with more threads
+    // than cores the search directions should still progress together.
+    bool first = waiting > 0;
+    for (Engine *e : active)
+      first |= e != this && e->waiting > 0 && e->rank(e->used) <= rank(used - 1);
+    if (!first)
+      return true;
+    n_free++;
+    used--;
+    share_cvar.notify_all();
+    return wait_core(lock);
+  }
+
+  void Engine::cancel() {
+    std::lock_guard<std::mutex> lock(tout_mtx);
+    if (!running) // the threads of a merely prepared engine must keep waiting for their cube
+      return;
+    done = true;
+    tout_cvar.notify_one();
+  }
+
   void Engine::finish() {
+    if (!done) { // prepared but not solving, i.e. the threads are still waiting for a cube
+      done = true;
+      job_mtx.unlock();
+    }
     for (std::thread& t : threads) // wait for all existing threads to actually finish
       t.join();
     threads.clear(); // they are now invalid
@@ -1,6 +1,8 @@
 #ifndef __SOLVE__
 #define __SOLVE__
 
+#include <atomic>
+#include <chrono>
 #include <condition_variable>
 #include <mutex>
 #include <queue>
@@ -21,6 +23,8 @@ namespace solve {
     int uedges;
     int dedges;
     int corners;
+    int fs1sym; // FLIPSLICE1 sym-coord
+    int dist1; // phase 1 distance
   };
 
   // Number of search directions
@@ -30,6 +34,17 @@ namespace solve {
     const int N_DIRS = 6;
   #endif
 
+  const int P2TT_BITS = 18; // log2 of the number of phase 2 transposition table entries
+
+  // Policies for splitting the shared cores among concurrent solves (see `share()`)
+  const int FAIR = 0; // every active solve gets an equal share; unused shares go to whoever can use them
+  const int DEADLINE = 1; // solves ending first (by their time-limit) get all the cores they can use first
+
+  /* Make all engines of the process share `n_cores` cores, i.e. at most that many search threads (over all engines)
+   * run at once; must be called before any solve. Every thread needs a core for each search task it runs. A single
+   * active solve can thus still use all cores while concurrent ones are split according to `policy`. */
+  void share(int n_cores, int policy);
+
   class Engine {
 
     int n_threads; // number of search threads
@@ -37,11 +52,18 @@ namespace solve {
     int n_sols; // number of solutions to find
     int max_len; // find solutions with at most this length; -1 means simply search for the full `tlimit`
     int tlim; // search for this amount of milliseconds
+    bool order; // expand phase 1 end states in order of their phase 2 estimate
+    int dflt_tlim; // constructor values restored by `limits()`
+    int dflt_n_sols;
+    int dflt_max_len;
+    bool weak; // current solve uses only the weak tables (see `prun::ready`)
 
     coordc dirs[N_DIRS]; // search directions
     move::mask masks[move::COUNT1]; // split masks
     int depths[N_DIRS]; // current search depths per direction
     int splits[N_DIRS]; // current search splits per direction
+    move::mask firsts[N_DIRS]; // permitted first moves per direction
+    move::mask lasts[N_DIRS]; // permitted last moves per direction
 
     bool done; // indicate that we are done
     int lenlim; // only look for solution that are strictly shorter than this
@@ -49,20 +71,53 @@ namespace solve {
     std::mutex sol_mtx; // thread-safety for reporting a solution
     std::priority_queue<searchres, std::vector<searchres>, decltype(&cmp)> sols {cmp}; // already found solutions
     std::vector<std::thread> threads; // search threads
+    int slot; // CPU slot of the first thread (see `numa::reserve()`); -1 if threads are not pinned
+
+    /* Phase 1 end states are reached over and over again with increasing phase 1 depth. Hence we remember "there is no
+     * phase 2 solution shorter than X" for them to avoid repeating the same failed phase 2 searches. Entries are only
+     * valid during the solve they have been created in (identified by its `p2tt_epoch`). */
+    std::atomic<uint64_t> *p2tt;
+    int p2tt_epoch;
 
     // Tools for implementing a required timeout
     std::mutex tout_mtx;
     std::condition_variable tout_cvar;
+    bool running; // threads are currently searching within `solve()`, i.e. `cancel()` has something to stop
+
+    // Usage of the shared cores (see `share()`); only accessed with the global lock held
+    int used; // cores currently held by this engine's threads
+    int waiting; // threads waiting for a core
+    std::chrono::steady_clock::time_point deadline; // end of the time-limit of the current solve
+    void enter(); // register / unregister a solve with the core sharing
+    void leave();
+    uint64_t since; // waiting order among the engines
+    bool acquire(); // wait for a core to run the next search task; false if the solve has ended meanwhile
+    void release();
+    int64_t rank(int held) const; // engines with smaller rank get cores first
+    bool may_run() const;
+    bool wait_core(std::unique_lock<std::mutex>& lock);
 
     public:
       Engine(
         int n_threads, int tlim,
-        int n_sols = 1, int max_len = -1, int n_splits = 1
+        int n_sols = 1, int max_len = -1, int n_splits = 1, bool order = false
       );
+      ~Engine();
       void prepare(); // setup all threads
-      void solve(const cubie::cube& c, std::vector<std::vector<int>>& res); // actual solve
+      // Time-limit, number of solutions and maximum length for the following solves; 0 selects the constructor's value
+      void limits(int tlim, int n_sols, int max_len);
+      // Actual solve; `first` and `last` restrict the first and last move of every solution (e.g. to the current grip)
+      void solve(
+        const cubie::cube& c, std::vector<std::vector<int>>& res,
+        move::mask first = ~move::mask(0), move::mask last = ~move::mask(0)
+      );
       void finish(); // wait for all threads to shutdown (mostly for clean program exit)
+      // Make a running `solve()` return right away with the solutions found so far; may be called from any thread
+      void cancel();
       void report_sol(searchres& sol); // report a solution; never call this from the outside
+      // Hand the core over if another solve goes first (see `share()`); false if the solve ended while waiting to get
+      // it back. Never call this from the outside.
+      bool yield();
 
     void thread(); // search thread
 
@@ -1,5 +1,9 @@
 #include "sym.h"
 
+#include <vector>
+
+#include "parallel.h"
+
 namespace sym {
 
   using namespace cubie::corner;
@@ -8,12 +12,19 @@ namespace sym {
   const uint32_t EMPTY = ~uint32_t(0);
 
   cubie::cube cubes[COUNT];
-  int inv[COUNT];
-  int effect[COUNT][3];
+  cubie::packed pcubes[COUNT];
+  int mul[COUNT_SUB][COUNT_SUB];
 
-  int conj_move[move::COUNT][COUNT];
+  #ifdef GENTABLES
+    int inv[COUNT];
+    int effect[COUNT][3];
+    int conj_move[move::COUNT][COUNT];
+  #else
+    #include "gen/sym.inc"
+  #endif
   uint16_t conj_twist[coord::N_TWIST][COUNT_SUB];
   uint16_t conj_udedges2[coord::N_UDEDGES2][COUNT_SUB];
+  uint16_t conj_slice2[coord::N_SLICE2][COUNT_SUB];
 
   uint32_t fslice1_sym[coord::N_FSLICE1];
   uint32_t corners_sym[coord::N_CORNERS];
@@ -22,6 +33,8 @@ namespace sym {
   uint16_t fslice1_selfs[N_FSLICE1];
   uint16_t corners_selfs[N_CORNERS];
 
+  uint32_t move_fslice1_sym[N_FSLICE1][move::COUNT_P1];
+
   void init_base() {
     cubie::cube c = cubie::SOLVED_CUBE;
     cubie::cube tmp;
@@ -51,6 +64,7 @@ namespace sym {
     // First 4 symmetries are the ones used in F5 mode
     for (int i = 0; i < COUNT; i++) {
       cubes[i] = c;
+      cubie::pack(c, pcubes[i]);
 
       cubie::mul(c, lr2, tmp);
       std::swap(tmp, c);
@@ -71,136 +85,221 @@ namespace sym {
 
     /* Maybe not the most efficient, but overall time spent here completely negligible. */
 
-    for (int i = 0; i < COUNT; i++) {
-      for (int j = 0; j < COUNT; j++) {
-        cubie::mul(cubes[i], cubes[j], c);
-        if (c == cubie::SOLVED_CUBE) {
-          inv[i] = j;
-          break;
+    #ifdef GENTABLES
+      for (int i = 0; i < COUNT; i++) {
+        for (int j = 0; j < COUNT; j++) {
+          cubie::mul(cubes[i], cubes[j], c);
+          if (c == cubie::SOLVED_CUBE) {
+            inv[i] = j;
+            break;
+          }
         }
       }
-    }
+    #endif
 
-    for (int m = 0; m < move::COUNT; m++) {
-      for (int s = 0; s < COUNT; s++) {
-        cubie::mul(cubes[s], move::cubes[m], tmp);
-        cubie::mul(tmp, cubes[inv[s]], c);
-        for (int conj = 0; conj < move::COUNT; conj++) {
-          if (c == move::cubes[conj]) {
-            conj_move[m][s] = conj;
+    for (int s1 = 0; s1 < COUNT_SUB; s1++) {
+      for (int s2 = 0; s2 < COUNT_SUB; s2++) {
+        cubie::mul(cubes[s1], cubes[s2], c);
+        for (int s = 0; s < COUNT_SUB; s++) { // reduction symmetries form a subgroup
+          if (c == cubes[s]) {
+            mul[s1][s2] = s;
             break;
           }
         }
       }
     }
 
-    /* Figure this out right here instead of defining even more "weird" constants */
-    int per_axis = move::COUNT1 / 3;
-    int per_face = 3;
-    #ifdef QT
-      per_face -= 1;
-    #endif
-    for (int s = 0; s < COUNT; s++) {
-      for (int ax = 0; ax < 3; ax++) {
-        effect[s][ax] = (conj_move[per_axis * ax][inv[s]] / per_axis) << 2; // shift
-        effect[s][ax] |= (conj_move[per_axis * ax][inv[s]] % per_axis >= per_face) << 1; // flip
-        effect[s][ax] |= (conj_move[per_axis * ax][inv[s]] % per_face != 0); // inv
+    #ifdef GENTABLES
+      for (int m = 0; m < move::COUNT; m++) {
+        for (int s = 0; s < COUNT; s++) {
+          cubie::mul(cubes[s], move::cubes[m], tmp);
+          cubie::mul(tmp, cubes[inv[s]], c);
+          for (int conj = 0; conj < move::COUNT; conj++) {
+            if (c == move::cubes[conj]) {
+              conj_move[m][s] = conj;
+              break;
+            }
+          }
+        }
       }
-    }
+
+      /* Figure this out right here instead of defining even more "weird" constants */
+      int per_axis = move::COUNT1 / 3;
+      int per_face = 3;
+      #ifdef QT
+        per_face -= 1;
+      #endif
+      for (int s = 0; s < COUNT; s++) {
+        for (int ax = 0; ax < 3; ax++) {
+          effect[s][ax] = (conj_move[per_axis * ax][inv[s]] / per_axis) << 2; // shift
+          effect[s][ax] |= (conj_move[per_axis * ax][inv[s]] % per_axis >= per_face) << 1; // flip
+          effect[s][ax] |= (conj_move[per_axis * ax][inv[s]] % per_face != 0); // inv
+        }
+      }
+    #endif
   }
 
   void init_conjcoord(
     uint16_t conj_coord[][COUNT_SUB],
     int n_coords,
-    int (*get_coord)(const cubie::cube&),
+    int (*get_coord)(const cubie::packed&),
     void (*set_coord)(cubie::cube&, int),
-    void (*mul)(const cubie::cube&, const cubie::cube&, cubie::cube&)
+    void (*mul)(const cubie::packed&, const cubie::packed&, cubie::packed&)
   ) {
-    cubie::cube c1 = cubie::SOLVED_CUBE; // make sure all multiplications will work
-    cubie::cube c2;
-    cubie::cube tmp;
+    parallel::blocks(n_coords, 1024, [&](int start, int end) {
+      cubie::cube c1 = cubie::SOLVED_CUBE; // make sure all multiplications will work
+      cubie::packed p1;
+      cubie::packed p2;
+      cubie::packed tmp;
 
-    for (int coord = 0; coord < n_coords; coord++) {
-      set_coord(c1, coord);
-      conj_coord[coord][0] = coord; // sym 0 is identity
-      for (int s = 1; s < COUNT_SUB; s++) {
-        mul(cubes[s], c1, tmp);
-        mul(tmp, cubes[inv[s]], c2);
-        conj_coord[coord][s] = get_coord(c2);
+      for (int coord = start; coord < end; coord++) {
+        set_coord(c1, coord);
+        cubie::pack(c1, p1);
+        conj_coord[coord][0] = coord; // sym 0 is identity
+        for (int s = 1; s < COUNT_SUB; s++) {
+          mul(pcubes[s], p1, tmp);
+          mul(tmp, pcubes[inv[s]], p2);
+          conj_coord[coord][s] = get_coord(p2);
+        }
       }
-    }
+    });
   }
 
-  void init_fslice1() {
-    std::fill(fslice1_sym, fslice1_sym + coord::N_FSLICE1, EMPTY);
+  /* Every coordinate checks whether it is the smallest one of its class, i.e. the representative a serial enumeration
+   * would find first. Only the thread finding it ever writes the class entries; the others at most waste a few
+   * conjugations on coordinates that were not reached yet. Classes are then numbered in coordinate order, thus giving
+   * exactly the same result as the serial version. */
+  template <typename T>
+  void init_classes(
+    uint32_t coord_sym[],
+    T coord_raw[],
+    uint16_t coord_selfs[],
+    int n_coords,
+    int (*get_coord)(const cubie::packed&),
+    void (*set_coord)(cubie::cube&, int),
+    void (*mul)(const cubie::packed&, const cubie::packed&, cubie::packed&)
+  ) {
+    std::fill(coord_sym, coord_sym + n_coords, EMPTY);
+    std::vector<uint16_t> selfs(n_coords); // indexed by representative for now
 
-    cubie::cube c1 = cubie::SOLVED_CUBE;
-    cubie::cube c2;
-    cubie::cube tmp;
-    int cls = 0;
+    parallel::blocks(n_coords, 1024, [&](int start, int end) {
+      cubie::cube c1 = cubie::SOLVED_CUBE;
+      cubie::packed p1;
+      cubie::packed p2;
+      cubie::packed tmp;
+      int conj[COUNT_SUB];
 
-    for (int slice1 = 0; slice1 < coord::N_SLICE1; slice1++) {
-      coord::set_slice1(c1, slice1); // SLICE is slightly more expensive to set
-      for (int flip = 0; flip < coord::N_FLIP; flip++) {
-        coord::set_flip(c1, flip);
-        int fslice1 = coord::fslice1(flip, slice1);
+      for (int coord = start; coord < end; coord++) {
+        if (__atomic_load_n(&coord_sym[coord], __ATOMIC_RELAXED) != EMPTY)
+          continue;
+        set_coord(c1, coord);
+        cubie::pack(c1, p1);
 
-        if (fslice1_sym[fslice1] != EMPTY)
+        bool repr = true;
+        for (int s = 1; s < COUNT_SUB && repr; s++) {
+          mul(pcubes[inv[s]], p1, tmp);
+          mul(tmp, pcubes[s], p2);
+          conj[s] = get_coord(p2);
+          repr = conj[s] >= coord;
+        }
+        if (!repr)
           continue;
-        fslice1_sym[fslice1] = COUNT_SUB * cls;
-        fslice1_raw[cls] = fslice1;
-        fslice1_selfs[cls] = 1; // symmetry 0 is identity and always a self-sym
 
+        __atomic_store_n(&coord_sym[coord], COUNT_SUB * coord, __ATOMIC_RELAXED);
+        selfs[coord] = 1; // symmetry 0 is identity and always a self-sym
         for (int s = 1; s < COUNT_SUB; s++) {
-          cubie::edge::mul(cubes[inv[s]], c1, tmp);
-          cubie::edge::mul(tmp, cubes[s], c2);
-          int fslice11 = coord::fslice1(coord::get_flip(c2), coord::get_slice1(c2));
-          if (fslice1_sym[fslice11] == EMPTY)
-            fslice1_sym[fslice11] = COUNT_SUB * cls + s;
-          else if (fslice11 == fslice1) // collect self-symmetries
-            fslice1_selfs[cls] |= 1 << s;
+          if (coord_sym[conj[s]] == EMPTY)
+            __atomic_store_n(&coord_sym[conj[s]], COUNT_SUB * coord + s, __ATOMIC_RELAXED);
+          else if (conj[s] == coord) // collect self-symmetries
+            selfs[coord] |= 1 << s;
         }
-        cls++;
+      }
+    });
+
+    std::vector<uint32_t> cls(n_coords);
+    int n_cls = 0;
+    for (int coord = 0; coord < n_coords; coord++) {
+      if (coord_sym[coord] == uint32_t(COUNT_SUB * coord)) {
+        cls[coord] = n_cls;
+        coord_raw[n_cls] = coord;
+        coord_selfs[n_cls] = selfs[coord];
+        n_cls++;
       }
     }
+    parallel::blocks(n_coords, 1 << 16, [&](int start, int end) {
+      for (int coord = start; coord < end; coord++)
+        coord_sym[coord] = COUNT_SUB * cls[coord_c(coord_sym[coord])] + coord_s(coord_sym[coord]);
+    });
+  }
+
+  int get_fslice1(const cubie::packed& p) {
+    return coord::fslice1(coord::get_flip(p), coord::get_slice1(p));
   }
 
-  void init_corners() {
-    std::fill(corners_sym, corners_sym + coord::N_CORNERS, EMPTY);
+  void set_fslice1(cubie::cube& c, int fslice1) {
+    coord::set_slice1(c, coord::fslice1_to_slice1(fslice1));
+    coord::set_flip(c, coord::fslice1_to_flip(fslice1));
+  }
 
-    cubie::cube c1 = cubie::SOLVED_CUBE;
-    cubie::cube c2;
-    cubie::cube tmp;
-    int cls = 0;
-
-    for (int corners = 0; corners < coord::N_CORNERS; corners++) {
-      coord::set_corners(c1, corners);
-
-      if (corners_sym[corners] != EMPTY)
-        continue;
-      corners_sym[corners] = COUNT_SUB * cls;
-      corners_raw[cls] = corners;
-      corners_selfs[cls] = 1;
-
-      for (int s = 1; s < COUNT_SUB; s++) {
-        cubie::corner::mul(cubes[inv[s]], c1, tmp);
-        cubie::corner::mul(tmp, cubes[s], c2);
-        int corners1 = coord::get_corners(c2);
-        if (corners_sym[corners1] == EMPTY)
-          corners_sym[corners1] = COUNT_SUB * cls + s;
-        else if (corners1 == corners)
-          corners_selfs[cls] |= 1 << s;
+  // A sym-coord (c, s) represents S^-1 R S, hence moving it by M gives S^-1 (R S M S^-1) S and R S M S^-1 is just R
+  // moved by the conjugated move
+  void init_move_fslice1() {
+    parallel::blocks(N_FSLICE1, 1024, [](int start, int end) {
+      for (int cls = start; cls < end; cls++) {
+        int flip = coord::fslice1_to_flip(fslice1_raw[cls]);
+        int slice = coord::slice1_to_slice(coord::fslice1_to_slice1(fslice1_raw[cls]));
+        for (int m = 0; m < move::COUNT_P1; m++) {
+          int slice1 = coord::slice_to_slice1(coord::move_edges4[slice][m]);
+          move_fslice1_sym[cls][m] = fslice1_sym[coord::fslice1(coord::move_flip[flip][m], slice1)];
+        }
       }
-      cls++;
+    });
+  }
+
+  // Renumber FLIPSLICE1 classes in BFS order from the goal. Most search nodes are close to the goal and will hence all
+  // hit a small contiguous part of the phase 1 table while children of a node typically end up in nearby classes.
+  void order_fslice1() {
+    std::vector<int> order; // old class indices in new order
+    std::vector<int> perm(N_FSLICE1, -1); // old -> new class index
+    order.reserve(N_FSLICE1);
+
+    int cls = coord_c(fslice1_sym[coord::fslice1(0, coord::SLICE1_SOLVED)]);
+    order.push_back(cls);
+    perm[cls] = 0;
+    for (size_t i = 0; i < order.size(); i++) {
+      for (int m = 0; m < move::COUNT_P1; m++) {
+        int cls1 = coord_c(move_fslice1_sym[order[i]][m]);
+        if (perm[cls1] == -1) {
+          perm[cls1] = order.size();
+          order.push_back(cls1);
+        }
+      }
+    }
+
+    std::vector<uint32_t> raw(fslice1_raw, fslice1_raw + N_FSLICE1);
+    std::vector<uint16_t> selfs(fslice1_selfs, fslice1_selfs + N_FSLICE1);
+    for (int cls = 0; cls < N_FSLICE1; cls++) {
+      fslice1_raw[cls] = raw[order[cls]];
+      fslice1_selfs[cls] = selfs[order[cls]];
     }
+    for (int fslice1 = 0; fslice1 < coord::N_FSLICE1; fslice1++)
+      fslice1_sym[fslice1] = COUNT_SUB * perm[coord_c(fslice1_sym[fslice1])] + coord_s(fslice1_sym[fslice1]);
+    init_move_fslice1(); // cheaper to simply recompute
   }
 
   void init() {
     init_base();
     init_conjcoord(conj_twist, coord::N_TWIST, coord::get_twist, coord::set_twist, cubie::corner::mul);
     init_conjcoord(conj_udedges2, coord::N_UDEDGES2, coord::get_udedges2, coord::set_udedges2, cubie::edge::mul);
-    init_fslice1();
-    init_corners();
+    init_conjcoord(conj_slice2, coord::N_SLICE2, coord::get_slice2, coord::set_slice2, cubie::edge::mul);
+    init_classes(
+      fslice1_sym, fslice1_raw, fslice1_selfs, coord::N_FSLICE1, get_fslice1, set_fslice1, cubie::edge::mul
+    );
+    init_move_fslice1();
+    order_fslice1();
+    init_classes(
+      corners_sym, corners_raw, corners_selfs, coord::N_CORNERS, coord::get_corners, coord::set_corners, cubie::corner::mul
+    );
   }
 
 }
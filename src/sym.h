@@ -26,12 +26,15 @@ namespace sym {
   #endif
 
   extern cubie::cube cubes[COUNT];
-  extern int inv[COUNT];
-  extern int effect[COUNT][3];
+  extern cubie::packed pcubes[COUNT];
+  extern GENCONST int inv[COUNT];
+  extern GENCONST int effect[COUNT][3];
+  extern int mul[COUNT_SUB][COUNT_SUB]; // index of the product of two (reduction) symmetries
 
-  extern int conj_move[move::COUNT][COUNT];
+  extern GENCONST int conj_move[move::COUNT][COUNT];
   extern uint16_t conj_twist[coord::N_TWIST][COUNT_SUB];
   extern uint16_t conj_udedges2[coord::N_UDEDGES2][COUNT_SUB];
+  extern uint16_t conj_slice2[coord::N_SLICE2][COUNT_SUB];
 
   extern uint32_t fslice1_sym[coord::N_FSLICE1];
   extern uint32_t corners_sym[coord::N_CORNERS];
@@ -40,12 +43,22 @@ namespace sym {
   extern uint16_t fslice1_selfs[N_FSLICE1];
   extern uint16_t corners_selfs[N_CORNERS];
 
+  // Move FLIPSLICE1 sym-coords directly; a class moved by `conj_move[m][s]` for a sym-coord with symmetry `s`
+  extern uint32_t move_fslice1_sym[N_FSLICE1][move::COUNT_P1];
+
   inline bool eff_inv(int eff) { return eff & 1; }
   inline bool eff_flip(int eff) { return eff & 2; }
   inline int eff_shift(int eff) { return eff >> 2; }
   inline int coord_c(int coord) { return coord / COUNT_SUB; }
   inline int coord_s(int coord) { return coord % COUNT_SUB; }
 
+  // Apply move `m` to a FLIPSLICE1 sym-coord without ever going through the raw coordinate
+  inline int move_fslice1(int fs1sym, int m) {
+    int s = coord_s(fs1sym);
+    int tmp = move_fslice1_sym[coord_c(fs1sym)][conj_move[m][s]];
+    return COUNT_SUB * coord_c(tmp) + mul[coord_s(tmp)][s];
+  }
+
   void init();
 
 }
@@ -9,7 +9,10 @@
 
 #include "coord.h"
 #include "cubie.h"
+#include "face.h"
+#include "huff.h"
 #include "move.h"
+#include "proto.h"
 #include "prun.h"
 #include "sym.h"
 
@@ -44,6 +47,23 @@ void test_cubie() {
   if (check(c) == 0)
     error();
 
+  // Packed multiplication must agree, also for mirrored corner orientations
+  cubie::packed p1, p2, p3;
+  for (int i = 0; i < 100; i++) {
+    cubie::shuffle(c);
+    cubie::mul(sym::cubes[i % sym::COUNT], c, tmp1);
+    cubie::pack(sym::cubes[i % sym::COUNT], p1);
+    cubie::pack(c, p2);
+    cubie::mul(p1, p2, p3);
+    cubie::unpack(p3, tmp2);
+    if (tmp1 != tmp2)
+      error();
+    cubie::inv(p3, p1);
+    cubie::mul(p3, p1, p2);
+    if (p2 != cubie::PACKED_SOLVED)
+      error();
+  }
+
   ok();
 }
 
@@ -57,10 +77,9 @@ void test_getset(int (*get_coord)(const cubie::cube&), void (*set_coord)(cubie::
   ok();
 }
 
-void test_movecoord(uint16_t move_coord[][move::COUNT], int n_coord, move::mask moves = move::p1mask | move::p2mask) {
+void test_movecoord(const uint16_t move_coord[][move::COUNT_P1], int n_coord) {
   for (int coord = 0; coord < n_coord; coord++) {
-    for (; moves; moves &= moves - 1) {
-      int m = ffsll(moves) - 1;
+    for (int m = 0; m < move::COUNT_P1; m++) {
       if (move_coord[move_coord[coord][m]][move::inv[m]] != coord)
         error();
       if (move_coord[move_coord[coord][move::inv[m]]][m] != coord)
@@ -70,6 +89,19 @@ void test_movecoord(uint16_t move_coord[][move::COUNT], int n_coord, move::mask
   ok();
 }
 
+void test_movecoord2(const uint16_t move_coord[][move::COUNT_P2], int n_coord) {
+  for (int coord = 0; coord < n_coord; coord++) {
+    for (int m = 0; m < move::COUNT_P2; m++) {
+      int inv = ffsll(move::to_p2(move::bit(move::inv[move::p2moves[m]]))) - 1;
+      if (move_coord[move_coord[coord][m]][inv] != coord)
+        error();
+      if (move_coord[move_coord[coord][inv]][m] != coord)
+        error();
+    }
+  }
+  ok();
+}
+
 void test_coord() {
   std::cout << "Testing coord level ..." << std::endl;
   test_getset(coord::get_flip, coord::set_flip, coord::N_FLIP);
@@ -86,7 +118,9 @@ void test_coord() {
   test_movecoord(coord::move_twist, coord::N_TWIST);
   test_movecoord(coord::move_edges4, coord::N_SLICE);
   test_movecoord(coord::move_corners, coord::N_CORNERS);
-  test_movecoord(coord::move_udedges2, coord::N_UDEDGES2, move::p2mask);
+  test_movecoord2(coord::move_slice2, coord::N_SLICE2);
+  test_movecoord2(coord::move_corners2, coord::N_CORNERS);
+  test_movecoord2(coord::move_udedges2, coord::N_UDEDGES2);
 }
 
 void test_move() {
@@ -103,6 +137,19 @@ void test_move() {
     if (c != cubie::SOLVED_CUBE)
       error();
   }
+  if (move::p1mask != move::bit(move::COUNT_P1) - 1) // phase 1 moves must come first
+    error();
+  if (std::bitset<64>(move::p2mask).count() != move::COUNT_P2)
+    error();
+  if (move::faces("UDRLFB") != (move::p1mask | move::p2mask) || move::faces("X") != 0)
+    error();
+  #ifdef F5
+    if (move::faces("B") != 0) // must be rejected rather than make every solve fail
+      error();
+  #else
+    if (move::faces("B") == 0)
+      error();
+  #endif
   ok();
 
   std::cout << "Phase 1: ";
@@ -149,10 +196,112 @@ void test_conj(uint16_t conj_coord[][sym::COUNT_SUB], int n_coord) {
   ok();
 }
 
+void test_movesym() {
+  cubie::cube c = cubie::SOLVED_CUBE;
+  cubie::cube c1;
+  cubie::cube tmp;
+
+  for (int fslice1 = 0; fslice1 < coord::N_FSLICE1; fslice1++) {
+    int fs1sym = sym::fslice1_sym[fslice1];
+    coord::set_flip(c, coord::fslice1_to_flip(fslice1));
+    coord::set_slice1(c, coord::fslice1_to_slice1(fslice1));
+
+    for (int m = 0; m < move::COUNT_P1; m++) {
+      int fs1sym1 = sym::move_fslice1(fs1sym, m);
+      // Moved sym-coord must represent exactly the same raw coordinate
+      int s = sym::coord_s(fs1sym1);
+      int raw = sym::fslice1_raw[sym::coord_c(fs1sym1)];
+      coord::set_flip(c1, coord::fslice1_to_flip(raw));
+      coord::set_slice1(c1, coord::fslice1_to_slice1(raw));
+      cubie::edge::mul(sym::cubes[sym::inv[s]], c1, tmp);
+      cubie::edge::mul(tmp, sym::cubes[s], c1);
+      cubie::edge::mul(c, move::cubes[m], tmp);
+      if (coord::get_flip(c1) != coord::get_flip(tmp) || coord::get_slice1(c1) != coord::get_slice1(tmp))
+        error();
+    }
+  }
+  ok();
+}
+
 void test_sym() {
   std::cout << "Testing sym level ..." << std::endl;
   test_conj(sym::conj_twist, coord::N_TWIST);
   test_conj(sym::conj_udedges2, coord::N_UDEDGES2);
+  test_conj(sym::conj_slice2, coord::N_SLICE2);
+  test_movesym();
+}
+
+void test_huff() {
+  std::cout << "Testing table compression ..." << std::endl;
+
+  srand(0);
+  std::vector<uint8_t> data(100003); // odd size, not a multiple of the entry width
+  for (int kind = 0; kind < 3; kind++) {
+    for (int i = 0; i < data.size(); i++) {
+      if (kind == 0)
+        data[i] = rand(); // incompressible
+      else if (kind == 1)
+        data[i] = __builtin_ctz(rand() | 0x100); // few skewed values
+      else
+        data[i] = i % 4 == 0 ? 7 : 0; // constant lanes
+    }
+    for (int width : {1, 4, 8}) {
+      std::vector<uint8_t> enc = huff::encode(data.data(), data.size(), width);
+      if (enc.size() > huff::max_size(data.size(), width))
+        error();
+      std::vector<uint8_t> dec(data.size());
+      if (huff::decode(enc.data(), enc.size(), dec.data(), dec.size(), width) || dec != data)
+        error();
+      if (!huff::decode(enc.data(), enc.size() - 1, dec.data(), dec.size(), width)) // truncation must be detected
+        error();
+    }
+  }
+  ok();
+}
+
+void test_proto() {
+  std::cout << "Testing binary protocol ..." << std::endl;
+
+  proto::request req = {};
+  std::string s = face::from_cubie(cubie::SOLVED_CUBE);
+  std::copy(s.begin(), s.end(), req.cube);
+  cubie::cube c;
+  move::mask first = move::p1mask;
+  move::mask last = move::p1mask;
+  if (proto::decode(req, c, first, last) != proto::OK || c != cubie::SOLVED_CUBE || first != move::p1mask)
+    error();
+
+  req.format = 2;
+  if (proto::decode(req, c, first, last) != proto::EFORMAT)
+    error();
+  req.format = proto::FACELETS;
+  req.cube[0] = 'X';
+  if (proto::decode(req, c, first, last) != proto::EFACE)
+    error();
+  req.format = proto::CUBIE;
+  std::fill(req.cube, req.cube + sizeof(req.cube), 0);
+  if (proto::decode(req, c, first, last) != proto::ECUBIE)
+    error();
+  std::copy(s.begin(), s.end(), req.cube);
+  req.format = proto::FACELETS;
+
+  req.first = 1 << 5; // B
+  req.last = 1 << 0; // U
+  int status = proto::decode(req, c, first, last);
+  #ifdef F5
+    if (status != proto::EFACES)
+  #else
+    if (status != proto::OK || first != move::faces("B") || last != move::faces("U"))
+  #endif
+    error();
+
+  std::vector<uint8_t> out;
+  proto::encode(7, proto::OK, 42, {{0, 1}, {}}, out);
+  const proto::response *res = (const proto::response *) out.data();
+  if (out.size() != sizeof(proto::response) + 4 || res->id != 7 || res->n_sols != 2 || res->size != 4)
+    error();
+
+  ok();
 }
 
 void test_prun() {
@@ -200,6 +349,32 @@ void test_prun() {
       error();
   }
 
+  prun::init_phase2next(false);
+  for (int i = 0; i < 1000; i++) {
+    int corners = rand() % coord::N_CORNERS;
+    int udedges2 = rand() % coord::N_UDEDGES2;
+
+    int dist = prun::get_phase2(corners, udedges2);
+    for (int togo = dist; togo < dist + 4; togo++) {
+      int dist1;
+      move::mask next = prun::get_next2(corners, udedges2, togo, dist1);
+      if (dist1 != dist)
+        error();
+
+      move::mask next1 = 0;
+      for (int m = 0; m < move::COUNT_P2; m++) {
+        if (prun::get_phase2(coord::move_corners2[corners][m], coord::move_udedges2[udedges2][m]) < togo)
+          next1 |= move::bit(m);
+      }
+      #if defined(QT) && defined(AX)
+        if ((next & next1) != next1) // AXQT may contain some extra half-turns
+      #else
+        if (next != next1)
+      #endif
+        error();
+    }
+  }
+
   ok();
 }
 
@@ -218,6 +393,7 @@ bool check(const cubie::cube &c, const std::vector<int>& sol) {
 
 int main() {
   auto tick = std::chrono::high_resolution_clock::now();
+  face::init();
   move::init();
   coord::init();
   sym::init();
@@ -228,6 +404,8 @@ int main() {
   test_coord();
   test_move();
   test_sym();
+  test_huff();
+  test_proto();
   test_prun();
 
   return 0;
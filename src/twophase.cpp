@@ -0,0 +1,169 @@
+#include "twophase.h"
+
+#include <algorithm>
+#include <cstring>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "cubie.h"
+#include "coord.h"
+#include "face.h"
+#include "move.h"
+#include "prun.h"
+#include "solve.h"
+#include "sym.h"
+
+struct twophase_engine {
+  solve::Engine solver;
+
+  twophase_engine(int n_threads, int tlim, int n_sols, int max_len, int n_splits, bool order) :
+    solver(n_threads, tlim, n_sols, max_len, n_splits, order) {}
+};
+
+namespace twophase {
+
+  std::mutex init_mtx;
+  bool loaded = false;
+
+  int solve(
+    twophase_engine *engine, const cubie::cube& c, const char *first, const char *last,
+    int *moves, int max_moves, int *lens
+  ) {
+    move::mask first1 = ~move::mask(0);
+    move::mask last1 = ~move::mask(0);
+    if ((first && (first1 = move::faces(first)) == 0) || (last && (last1 = move::faces(last)) == 0))
+      return TWOPHASE_EFACES;
+
+    std::vector<std::vector<int>> sols;
+    engine->solver.solve(c, sols, first1, last1); // spawns the threads itself unless `twophase_prepare()` did
+
+    int total = 0;
+    for (auto& sol : sols)
+      total += sol.size();
+    if (total > max_moves)
+      return TWOPHASE_ESPACE;
+
+    for (size_t i = 0; i < sols.size(); i++) {
+      lens[i] = sols[i].size();
+      for (int m : sols[i])
+        *moves++ = m;
+    }
+    return sols.size();
+  }
+
+}
+
+extern "C" {
+
+int twophase_init(int lowmem, int phase2raw, int phase2x, int phase2next) {
+  std::lock_guard<std::mutex> lock(twophase::init_mtx);
+  if (twophase::loaded)
+    return TWOPHASE_OK;
+  if (lowmem && (phase2raw || phase2next)) // see `-d` of the tool
+    return TWOPHASE_EINIT;
+
+  try {
+    face::init();
+    move::init();
+    coord::init();
+    sym::init();
+    if (
+      prun::init(true, lowmem) || (phase2x && prun::init_phase2x(true)) || (phase2next && prun::init_phase2next(true))
+    )
+      return TWOPHASE_EINIT;
+    if (phase2raw)
+      prun::init_phase2raw();
+  } catch (...) { // e.g. `bad_alloc` for one of the large tables
+    return TWOPHASE_EINIT;
+  }
+
+  twophase::loaded = true;
+  return TWOPHASE_OK;
+}
+
+void twophase_share(int n_cores, int deadline) {
+  solve::share(n_cores, deadline ? solve::DEADLINE : solve::FAIR);
+}
+
+twophase_engine *twophase_engine_new(int n_threads, int tlim, int n_sols, int max_len, int n_splits, int order) {
+  {
+    std::lock_guard<std::mutex> lock(twophase::init_mtx);
+    if (!twophase::loaded)
+      return nullptr;
+  }
+  if (n_threads <= 0 || tlim < 0 || n_sols <= 0 || n_splits <= 0)
+    return nullptr;
+  try {
+    return new twophase_engine(n_threads, tlim, n_sols, max_len, n_splits, order != 0);
+  } catch (...) { // no exceptions across the C interface
+    return nullptr;
+  }
+}
+
+void twophase_engine_free(twophase_engine *engine) {
+  engine->solver.finish();
+  delete engine;
+}
+
+int twophase_prepare(twophase_engine *engine) {
+  try {
+    engine->solver.prepare();
+  } catch (...) {
+    return TWOPHASE_ESYS;
+  }
+  return TWOPHASE_OK;
+}
+
+int twophase_solve(
+  twophase_engine *engine, const char *facecube, const char *first, const char *last,
+  int *moves, int max_moves, int *lens
+) {
+  // `to_cubie()` reads all facelets unchecked
+  if (facecube == NULL || strnlen(facecube, face::N_FACELETS + 1) != face::N_FACELETS)
+    return TWOPHASE_EFACE;
+  try {
+    cubie::cube c;
+    if (face::to_cubie(facecube, c) != 0)
+      return TWOPHASE_EFACE;
+    if (cubie::check(c) != 0)
+      return TWOPHASE_ECUBIE;
+    return twophase::solve(engine, c, first, last, moves, max_moves, lens);
+  } catch (...) {
+    return TWOPHASE_ESYS;
+  }
+}
+
+int twophase_solve_cubie(
+  twophase_engine *engine, const int cperm[8], const int cori[8], const int eperm[12], const int eori[12],
+  const char *first, const char *last, int *moves, int max_moves, int *lens
+) {
+  cubie::cube c;
+  std::copy(cperm, cperm + cubie::corner::COUNT, c.cperm);
+  std::copy(cori, cori + cubie::corner::COUNT, c.cori);
+  std::copy(eperm, eperm + cubie::edge::COUNT, c.eperm);
+  std::copy(eori, eori + cubie::edge::COUNT, c.eori);
+  if (cubie::check(c) != 0)
+    return TWOPHASE_ECUBIE;
+  try {
+    return twophase::solve(engine, c, first, last, moves, max_moves, lens);
+  } catch (...) {
+    return TWOPHASE_ESYS;
+  }
+}
+
+void twophase_cancel(twophase_engine *engine) {
+  engine->solver.cancel();
+}
+
+int twophase_move_count(void) {
+  return move::COUNT;
+}
+
+const char *twophase_move_name(int m) {
+  if (m < 0 || m >= move::COUNT)
+    return nullptr;
+  return move::names[m].c_str();
+}
+
+}
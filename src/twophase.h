@@ -0,0 +1,73 @@
+/**
+ * C interface of `libtwophase` for solving directly in-process (e.g. from a robot controller), without going through
+ * the text protocol of the CMD-tool. The solving mode is fixed by the flags the library was compiled with, exactly as
+ * for the tool. Tables are loaded from (or generated into) the current working directory.
+ *
+ * An engine must only be used by one thread at a time; the single exception is `twophase_cancel()` which may be called
+ * from any thread to stop a running solve.
+ */
+
+#ifndef __TWOPHASE__
+#define __TWOPHASE__
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Return codes; solving returns the number of solutions on success */
+#define TWOPHASE_OK 0
+#define TWOPHASE_EINIT -1 /* tables could not be loaded or were not loaded yet */
+#define TWOPHASE_EFACE -2 /* invalid facelet string */
+#define TWOPHASE_ECUBIE -3 /* cube is not solvable */
+#define TWOPHASE_EFACES -4 /* first/last move faces are not a subset of "UDRLFB" or only "B" with -DF5 */
+#define TWOPHASE_ESPACE -5 /* output buffers too small */
+#define TWOPHASE_ESYS -6 /* out of memory or search threads could not be started */
+
+#define TWOPHASE_MAX_LEN 50 /* solutions always have fewer moves than this */
+
+typedef struct twophase_engine twophase_engine;
+
+/* Loads all tables (generating them first if necessary, which may take minutes); `lowmem`, `phase2raw`, `phase2x` and
+ * `phase2next` correspond to the tool's `-d`, `-r`, `-x` and `-v`. Only the first successful call does anything. */
+int twophase_init(int lowmem, int phase2raw, int phase2x, int phase2next);
+
+/* Makes all engines share `n_cores` cores instead of each running all of its threads at once (e.g. one engine per
+ * robot arm); concurrent solves split them equally or, if `deadline` is set, by earliest time-limit first. A single
+ * active solve still uses all of them. Must be called before any solve. */
+void twophase_share(int n_cores, int deadline);
+
+/* Parameters as for the tool's `-t`, `-m`, `-n`, `-l` (-1 for none), `-s` and `-o`; NULL if they are invalid or the
+ * tables are not loaded */
+twophase_engine *twophase_engine_new(int n_threads, int tlim, int n_sols, int max_len, int n_splits, int order);
+/* Call from the thread that last prepared or solved with `engine` */
+void twophase_engine_free(twophase_engine *engine);
+
+/* Spawns the search threads for the next solve ahead of time (e.g. right after the previous one while the robot is
+ * still turning) s.t. the solve itself does not pay for this; otherwise every solve spawns them on its own. Call from
+ * the thread that will solve next as the threads are released by it. Returns `TWOPHASE_OK` or `TWOPHASE_ESYS`. */
+int twophase_prepare(twophase_engine *engine);
+
+/* Solves the cube given by its facelet string (see `face.h`). The moves of all found solutions (best first) are written
+ * consecutively to `moves` (capacity `max_moves`) with their lengths in `lens` (capacity `n_sols` of the engine).
+ * `first` and `last` restrict the faces of the first and last move like `-f` and `-e` (NULL for any). */
+int twophase_solve(
+  twophase_engine *engine, const char *facecube, const char *first, const char *last,
+  int *moves, int max_moves, int *lens
+);
+/* Same as `twophase_solve()` but for a cube given as cubie permutations and orientations (see `cubie.h`) */
+int twophase_solve_cubie(
+  twophase_engine *engine, const int cperm[8], const int cori[8], const int eperm[12], const int eori[12],
+  const char *first, const char *last, int *moves, int max_moves, int *lens
+);
+/* Makes a running solve of `engine` return right away with the solutions found so far */
+void twophase_cancel(twophase_engine *engine);
+
+/* Number of moves of the compiled mode and the name of move `m` (e.g. "U2" or "(U D')") */
+int twophase_move_count(void);
+const char *twophase_move_name(int m);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif